@@ -4,14 +4,14 @@
 #include <map>
 #include <memory>
 #include <unordered_map>
-#include <iostream>
 
 #include <glm/ext.hpp>
 #include <glm/gtx/hash.hpp>
 
 #include "PathingNode.hpp"
+#include "Planner.hpp"
 
-class AStar
+class AStar : public Planner
 {
 	public:
 	AStar(
@@ -19,7 +19,6 @@ class AStar
 	    glm::ivec3 end,
 	    std::function<bool(glm::ivec3)> obstacle)
 	{
-		std::cout << this << "\n";
 		m_end = end;
 		m_obstacle = obstacle;
 		auto start_candidate = std::make_shared<PathingNode>(start, end);
@@ -31,9 +30,8 @@ class AStar
 		}
 	}
 
-	bool run()
+	bool run() override
 	{
-		std::cout << this << "\n";
 		if (guaranteed_impossible)
 		{
 			return false;
@@ -54,12 +52,12 @@ class AStar
 		return false;
 	}
 
-	bool obstacle(glm::ivec3 pos)
+	bool obstacle(glm::ivec3 pos) override
 	{
 		return m_obstacle(pos);
 	}
 
-	std::vector<glm::ivec3> path_result()
+	std::vector<glm::ivec3> path_result() override
 	{
 		std::vector<glm::ivec3> result;
 		auto end = m_closed_nodes.find(m_end)->second.get();
@@ -72,12 +70,13 @@ class AStar
 		return result;
 	}
 
-	bool stop = false;
+	const char *name() const override { return "astar"; }
 
 	private:
 	bool guaranteed_impossible = false;
 	void single_iteration()
 	{
+		expanded_nodes++;
 		auto candidate = m_f_open_nodes.begin();
 		std::array<glm::ivec3, 6> new_candidates{
 		    candidate->second->position + glm::ivec3{-1, 0, 0},
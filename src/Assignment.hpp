@@ -0,0 +1,122 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <optional>
+#include <vector>
+
+// minimum cost assignment of tasks (rows) to workers (columns), each side
+// used at most once. pairs that can't go together have an infinite cost and
+// are never handed out, a task that gets no worker comes back as nullopt.
+// hungarian method with potentials, O(n^2 m) for n <= m
+inline std::vector<std::optional<size_t>>
+solve_assignment(const std::vector<std::vector<double>> &cost)
+{
+	size_t tasks = cost.size();
+	size_t workers = tasks == 0 ? 0 : cost[0].size();
+	std::vector<std::optional<size_t>> result(tasks);
+	if (tasks == 0 || workers == 0)
+	{
+		return result;
+	}
+
+	// the method wants no more rows than columns, flip it if needed
+	bool flipped = tasks > workers;
+	size_t rows = flipped ? workers : tasks;
+	size_t columns = flipped ? tasks : workers;
+	// infeasible pairs get a cost above any real assignment so they are
+	// only chosen when nothing else is left, and thrown out afterwards
+	double largest = 0;
+	for (auto &row : cost)
+	{
+		for (auto value : row)
+		{
+			if (std::isfinite(value))
+			{
+				largest = std::max(largest, std::abs(value));
+			}
+		}
+	}
+	double infeasible = (largest + 1) * static_cast<double>(rows + 1);
+	auto at = [&](size_t row, size_t column) {
+		double value = flipped ? cost[column][row] : cost[row][column];
+		return std::isfinite(value) ? value : infeasible;
+	};
+
+	constexpr double inf = std::numeric_limits<double>::infinity();
+	// 1 based, column 0 is the one the current row starts from
+	std::vector<double> row_potential(rows + 1, 0);
+	std::vector<double> column_potential(columns + 1, 0);
+	std::vector<size_t> row_of_column(columns + 1, 0), way(columns + 1, 0);
+	for (size_t row = 1; row <= rows; row++)
+	{
+		row_of_column[0] = row;
+		size_t column = 0;
+		std::vector<double> min_slack(columns + 1, inf);
+		std::vector<bool> used(columns + 1, false);
+		do
+		{
+			used[column] = true;
+			size_t current_row = row_of_column[column];
+			double delta = inf;
+			size_t next_column = 0;
+			for (size_t j = 1; j <= columns; j++)
+			{
+				if (used[j])
+				{
+					continue;
+				}
+				double slack = at(current_row - 1, j - 1)
+				               - row_potential[current_row]
+				               - column_potential[j];
+				if (slack < min_slack[j])
+				{
+					min_slack[j] = slack;
+					way[j] = column;
+				}
+				if (min_slack[j] < delta)
+				{
+					delta = min_slack[j];
+					next_column = j;
+				}
+			}
+			for (size_t j = 0; j <= columns; j++)
+			{
+				if (used[j])
+				{
+					row_potential[row_of_column[j]] += delta;
+					column_potential[j] -= delta;
+				}
+				else
+				{
+					min_slack[j] -= delta;
+				}
+			}
+			column = next_column;
+		} while (row_of_column[column] != 0);
+		do
+		{
+			size_t previous = way[column];
+			row_of_column[column] = row_of_column[previous];
+			column = previous;
+		} while (column != 0);
+	}
+
+	for (size_t j = 1; j <= columns; j++)
+	{
+		if (row_of_column[j] == 0)
+		{
+			continue;
+		}
+		size_t row = row_of_column[j] - 1;
+		size_t column = j - 1;
+		size_t task = flipped ? column : row;
+		size_t worker = flipped ? row : column;
+		if (std::isfinite(cost[task][worker]))
+		{
+			result[task] = worker;
+		}
+	}
+	return result;
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "Trace.hpp"
+#include "world.hpp"
+
+// owns the world for everything that isn't drawing it. one thread runs the
+// work the network thread posted, moves turtles along their paths and runs
+// the automation of every server in turn, all while holding the world. the
+// expensive part, path searches, still runs on threads of its own and reads
+// the world through World::shared_obstacle_function
+class AutomationEngine
+{
+	public:
+	using clock = std::chrono::steady_clock;
+	// how often turtles are looked at when nothing gets posted or comes due
+	constexpr static std::chrono::milliseconds default_poll_interval{50};
+
+	explicit AutomationEngine(
+	    World &world,
+	    std::chrono::milliseconds poll_interval = default_poll_interval)
+	    : m_world(world), m_poll_interval(poll_interval)
+	{
+	}
+	~AutomationEngine() { stop(); }
+	AutomationEngine(const AutomationEngine &) = delete;
+	AutomationEngine &operator=(const AutomationEngine &) = delete;
+
+	// runs on the engine's thread at the end of every tick, still holding
+	// the world. set it before start
+	std::function<void(World &)> after_tick;
+
+	void start()
+	{
+		if (!m_thread.joinable())
+		{
+			m_stop = false;
+			m_thread = std::thread{&AutomationEngine::run, this};
+		}
+	}
+
+	void stop()
+	{
+		if (m_thread.joinable())
+		{
+			m_stop = true;
+			//wakes it up if it is sleeping
+			m_world.executor.post([]() {});
+			m_thread.join();
+		}
+	}
+
+	private:
+	void run()
+	{
+		tracer().name_thread("automation");
+		while (!m_stop)
+		{
+			auto wake_at = clock::now() + m_poll_interval;
+			{
+				TraceSpan waiting{"lock world", "automation"};
+				WorldLock lock{m_world.world_mutex};
+				waiting.end();
+				wake_at = std::min(wake_at, tick());
+				if (after_tick)
+				{
+					TraceSpan span{"after_tick", "automation"};
+					after_tick(m_world);
+				}
+			}
+			m_world.executor.wait(wake_at);
+		}
+	}
+
+	// gives back when the first block on any server is due
+	clock::time_point tick()
+	{
+		TraceSpan span{"tick", "automation"};
+		TraceSpan pending{"run_pending", "automation"};
+		m_world.executor.run_pending();
+		pending.end();
+		m_world.update_reservations();
+		m_world.get_data_from_turtles();
+
+		std::vector<std::string> servers;
+		for (auto &server : m_world.m_blocks)
+		{
+			servers.push_back(server.first);
+		}
+		auto next_due = clock::time_point::max();
+		for (auto &server : servers)
+		{
+			TraceSpan step{"server_automation", "automation"};
+			if (m_started.insert(server).second)
+			{
+				start_server_automation(m_world, server);
+			}
+			server_automation_step(m_world, server);
+			next_due = std::min(
+			    next_due,
+			    m_world.block_scheduler_for(server).next_due());
+		}
+		return next_due;
+	}
+
+	World &m_world;
+	std::chrono::milliseconds m_poll_interval;
+	std::thread m_thread;
+	std::atomic<bool> m_stop = false;
+	// servers whose blocks have been scheduled, only touched by m_thread
+	std::unordered_set<std::string> m_started;
+};
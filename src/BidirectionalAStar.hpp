@@ -0,0 +1,177 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <functional>
+#include <map>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <glm/ext.hpp>
+#include <glm/gtx/hash.hpp>
+
+#include "Planner.hpp"
+
+// A* from both ends at once, stops when neither frontier can produce
+// anything shorter than the best meeting point found so far. an enclosed goal
+// is found out quickly because the backwards search runs dry
+class BidirectionalAStar : public Planner
+{
+	public:
+	BidirectionalAStar(
+	    glm::ivec3 start,
+	    glm::ivec3 end,
+	    std::function<bool(glm::ivec3)> obstacle)
+	    : m_obstacle(obstacle)
+	{
+		m_forward.origin = start;
+		m_forward.target = end;
+		m_backward.origin = end;
+		m_backward.target = start;
+		if ((m_obstacle(start) || m_obstacle(end)) && !(start == end))
+		{
+			guaranteed_impossible = true;
+		}
+	}
+
+	bool run() override
+	{
+		if (guaranteed_impossible)
+		{
+			return false;
+		}
+		if (m_forward.origin == m_backward.origin)
+		{
+			m_meeting = m_forward.origin;
+			m_best = 0;
+			return true;
+		}
+		m_forward.push(m_forward.origin, 0, m_forward.origin);
+		m_backward.push(m_backward.origin, 0, m_backward.origin);
+		while (!stop)
+		{
+			if (m_forward.open.empty() || m_backward.open.empty())
+			{
+				return m_meeting.has_value();
+			}
+			if (m_meeting
+			    && std::max(m_forward.min_f(), m_backward.min_f()) >= m_best)
+			{
+				return true;
+			}
+			if (m_forward.open.size() <= m_backward.open.size())
+			{
+				single_iteration(m_forward, m_backward);
+			}
+			else
+			{
+				single_iteration(m_backward, m_forward);
+			}
+		}
+		return false;
+	}
+
+	bool obstacle(glm::ivec3 pos) override { return m_obstacle(pos); }
+
+	std::vector<glm::ivec3> path_result() override
+	{
+		std::vector<glm::ivec3> result;
+		if (!m_meeting)
+		{
+			return result;
+		}
+		for (auto pos = *m_meeting; pos != m_forward.origin;
+		     pos = m_forward.parent.at(pos))
+		{
+			result.push_back(pos);
+		}
+		result.push_back(m_forward.origin);
+		std::reverse(result.begin(), result.end());
+		for (auto pos = *m_meeting; pos != m_backward.origin;)
+		{
+			pos = m_backward.parent.at(pos);
+			result.push_back(pos);
+		}
+		return result;
+	}
+
+	const char *name() const override { return "bidirectional"; }
+
+	private:
+	struct Search
+	{
+		glm::ivec3 origin;
+		glm::ivec3 target;
+		std::multimap<std::pair<int, int>, glm::ivec3> open;
+		std::unordered_map<glm::ivec3, int> g;
+		std::unordered_map<glm::ivec3, glm::ivec3> parent;
+		std::unordered_set<glm::ivec3> closed;
+
+		int heuristic(glm::ivec3 position) const
+		{
+			auto distance_diff = glm::abs(position - target);
+			return distance_diff.x + distance_diff.y + distance_diff.z;
+		}
+		void push(glm::ivec3 position, int new_g, glm::ivec3 from)
+		{
+			g[position] = new_g;
+			parent[position] = from;
+			open.insert({{new_g + heuristic(position), -new_g}, position});
+		}
+		int min_f() const { return open.begin()->first.first; }
+	};
+
+	void single_iteration(Search &search, Search &other)
+	{
+		auto candidate = search.open.begin();
+		auto position = candidate->second;
+		search.open.erase(candidate);
+		if (!search.closed.insert(position).second)
+		{
+			return;
+		}
+		expanded_nodes++;
+		int g = search.g.at(position);
+		std::array<glm::ivec3, 6> new_candidates{
+		    position + glm::ivec3{-1, 0, 0},
+		    position + glm::ivec3{1, 0, 0},
+		    position + glm::ivec3{0, -1, 0},
+		    position + glm::ivec3{0, 1, 0},
+		    position + glm::ivec3{0, 0, -1},
+		    position + glm::ivec3{0, 0, 1}};
+		for (auto &new_candidate : new_candidates)
+		{
+			if (search.closed.contains(new_candidate))
+			{
+				continue;
+			}
+			if (auto already = search.g.find(new_candidate);
+			    already != search.g.end() && already->second <= g + 1)
+			{
+				continue;
+			}
+			if (m_obstacle(new_candidate))
+			{
+				continue;
+			}
+			search.push(new_candidate, g + 1, position);
+			if (auto met = other.g.find(new_candidate); met != other.g.end())
+			{
+				if (g + 1 + met->second < m_best)
+				{
+					m_best = g + 1 + met->second;
+					m_meeting = new_candidate;
+				}
+			}
+		}
+	}
+
+	bool guaranteed_impossible = false;
+	std::function<bool(glm::ivec3)> m_obstacle;
+	Search m_forward;
+	Search m_backward;
+	std::optional<glm::ivec3> m_meeting;
+	int m_best = INT_MAX;
+};
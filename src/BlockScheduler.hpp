@@ -0,0 +1,145 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/ext.hpp>
+#include <glm/gtx/hash.hpp>
+
+// blocks of one server waiting for their next recheck, kept in a min-heap on
+// when they are due so the automation thread can sleep until the first one
+// instead of walking the whole world. rescheduling a block doesn't dig the
+// old entry out of the heap, it is skipped when it comes up
+class BlockScheduler
+{
+	public:
+	using clock = std::chrono::steady_clock;
+
+	struct Due
+	{
+		std::string dimension;
+		glm::ivec3 position;
+	};
+
+	void schedule(
+	    const std::string &dimension,
+	    glm::ivec3 position,
+	    clock::time_point when)
+	{
+		std::scoped_lock a{m_mutex};
+		auto generation = ++m_generation;
+		m_live[dimension][position] = generation;
+		m_heap.push(Entry{when, generation, dimension, position});
+		compact();
+	}
+
+	void cancel(const std::string &dimension, glm::ivec3 position)
+	{
+		std::scoped_lock a{m_mutex};
+		if (auto blocks = m_live.find(dimension); blocks != m_live.end())
+		{
+			blocks->second.erase(position);
+		}
+	}
+
+	// takes every block that is due at now out of the schedule, they have to
+	// be scheduled again to come back
+	std::vector<Due> pop_due(clock::time_point now)
+	{
+		std::scoped_lock a{m_mutex};
+		std::vector<Due> due;
+		while (!m_heap.empty() && m_heap.top().when <= now)
+		{
+			auto entry = m_heap.top();
+			m_heap.pop();
+			if (is_live(entry))
+			{
+				m_live[entry.dimension].erase(entry.position);
+				due.push_back({std::move(entry.dimension), entry.position});
+			}
+		}
+		return due;
+	}
+
+	// when the first block is due, time_point::max() if none are
+	clock::time_point next_due()
+	{
+		std::scoped_lock a{m_mutex};
+		while (!m_heap.empty() && !is_live(m_heap.top()))
+		{
+			m_heap.pop();
+		}
+		return m_heap.empty() ? clock::time_point::max() : m_heap.top().when;
+	}
+
+	size_t size()
+	{
+		std::scoped_lock a{m_mutex};
+		size_t count = 0;
+		for (auto &blocks : m_live)
+		{
+			count += blocks.second.size();
+		}
+		return count;
+	}
+
+	private:
+	struct Entry
+	{
+		clock::time_point when;
+		uint64_t generation;
+		std::string dimension;
+		glm::ivec3 position;
+
+		bool operator>(const Entry &other) const { return when > other.when; }
+	};
+
+	bool is_live(const Entry &entry)
+	{
+		auto blocks = m_live.find(entry.dimension);
+		if (blocks == m_live.end())
+		{
+			return false;
+		}
+		auto block = blocks->second.find(entry.position);
+		return block != blocks->second.end() && block->second == entry.generation;
+	}
+
+	// blocks that keep getting rescheduled early leave dead entries behind,
+	// rebuild once they outnumber the live ones
+	void compact()
+	{
+		size_t live = 0;
+		for (auto &blocks : m_live)
+		{
+			live += blocks.second.size();
+		}
+		if (m_heap.size() < 64 || m_heap.size() < live * 2)
+		{
+			return;
+		}
+		std::vector<Entry> kept;
+		while (!m_heap.empty())
+		{
+			if (is_live(m_heap.top()))
+			{
+				kept.push_back(m_heap.top());
+			}
+			m_heap.pop();
+		}
+		m_heap = decltype(m_heap){std::greater<>{}, std::move(kept)};
+	}
+
+	std::mutex m_mutex;
+	uint64_t m_generation = 0;
+	std::priority_queue<Entry, std::vector<Entry>, std::greater<>> m_heap;
+	// dimension -> position -> generation of the entry that counts
+	std::unordered_map<std::string, std::unordered_map<glm::ivec3, uint64_t>>
+	    m_live;
+};
@@ -1,12 +1,22 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <cassert>
 #include <chrono>
 #include <deque>
 #include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
 
 #include <boost/thread/future.hpp>
 
 #include "Common_Networking.hpp"
+#include "Metrics.hpp"
+#include "TimerWheel.hpp"
+#include "Trace.hpp"
+#include "TrafficRecorder.hpp"
 
 #include "nlohmann/json.hpp"
 
@@ -39,29 +49,107 @@ inline size_t hash(websocketpp::connection_hdl c)
 template <typename T = nlohmann::json>
 class CommandBuffer;
 
-class ComputerInterface
+// which queue a request to a turtle waits in. the turtle is sent the front of
+// the first lane with anything in it, so a click in the gui doesn't wait
+// behind a walk and a walk doesn't wait behind inventory polls
+enum class RequestLane
+{
+	interactive,
+	pathing,
+	background,
+};
+constexpr size_t request_lane_count = 3;
+
+inline const char *lane_name(RequestLane lane)
+{
+	constexpr const char *names[]{"interactive", "pathing", "background"};
+	return names[static_cast<size_t>(lane)];
+}
+
+// requests made on this thread while it is around go in lane, outside of one
+// they go in the pathing lane
+class RequestLaneScope
 {
 	public:
-	ComputerInterface(websocketpp::connection_hdl connection, server &endpoint)
-	    : m_connection(connection), m_endpoint(endpoint)
+	explicit RequestLaneScope(RequestLane lane) : m_previous(current())
 	{
-		m_endpoint.send(
-		    m_connection,
-		    std::string{"wake_up"},
-		    websocketpp::frame::opcode::text);
+		current() = lane;
+	}
+	~RequestLaneScope() { current() = m_previous; }
+	RequestLaneScope(const RequestLaneScope &) = delete;
+	RequestLaneScope &operator=(const RequestLaneScope &) = delete;
+
+	static RequestLane &current()
+	{
+		thread_local RequestLane lane = RequestLane::pathing;
+		return lane;
+	}
+
+	private:
+	RequestLane m_previous;
+};
+
+class ComputerInterface : public std::enable_shared_from_this<ComputerInterface>
+{
+	public:
+	using clock = std::chrono::steady_clock;
+	using Promise = std::shared_ptr<boost::promise<nlohmann::json>>;
+	using Promises = std::vector<Promise>;
+
+	// how long a request may go unanswered, and how many times it is sent
+	// again after that before its future gets an error and the turtle counts
+	// as gone. only requests that change nothing on the turtle are sent again
+	struct RequestPolicy
+	{
+		std::chrono::milliseconds timeout;
+		int retries = 0;
+	};
+	constexpr static RequestPolicy default_policy{
+	    std::chrono::milliseconds{10000},
+	    0};
+	// a command buffer gets this much more for every command in it
+	constexpr static std::chrono::milliseconds per_command_timeout{2000};
+	// an idle turtle nothing was heard from for this long is asked whether it
+	// is still there
+	constexpr static std::chrono::seconds heartbeat_interval{5};
+	// how long a turtle may take to ask for the next request after answering
+	constexpr static std::chrono::seconds ready_timeout{10};
+	// past this many waiting in a lane, requests going in it fail straight
+	// away, by lane
+	constexpr static std::array<size_t, request_lane_count> lane_capacity{
+	    16,
+	    256,
+	    64};
+
+	// every frame in and out is written to recorder if there is one, under
+	// connection_id. without timers requests have no deadlines and the turtle
+	// is never dropped, like in a replay
+	ComputerInterface(
+	    websocketpp::connection_hdl connection,
+	    server &endpoint,
+	    std::shared_ptr<TrafficRecorder> recorder = nullptr,
+	    uint32_t connection_id = 0,
+	    TimerWheel *timers = nullptr)
+	    : m_connection(connection), m_endpoint(endpoint),
+	      m_recorder(std::move(recorder)), m_connection_id(connection_id),
+	      m_timers(timers)
+	{
+		constexpr RequestPolicy idempotent{std::chrono::milliseconds{5000}, 2};
+		m_policies["authentication"] = idempotent;
+		m_policies["inspect"] = idempotent;
+		m_policies["inventory"] = idempotent;
+		m_policies["inventory_slot"] = idempotent;
+		send_frame("wake_up");
 	}
 	~ComputerInterface()
 	{
-		std::scoped_lock a{request_mutex};
-		for (auto &expected_response : m_request_queue)
+		// the timers only hold on to this weakly, they find nothing
+		Promises waiting;
 		{
-			auto promise = std::get<2>(expected_response);
-			promise->set_value(R"(
-				{
-					"error": "interface deconstructed"
-				}
-			)"_json);
+			std::scoped_lock a{request_mutex};
+			waiting = take_waiting();
 		}
+		fail(waiting, "interface deconstructed");
 	}
 
 	void send_stop()
@@ -69,10 +157,7 @@ class ComputerInterface
 		constexpr size_t stop_send_count = 3;
 		for (size_t i = 0; i < stop_send_count; i++)
 		{
-			m_endpoint.send(
-			    m_connection,
-			    make_stop().dump(),
-			    websocketpp::frame::opcode::text);
+			send_frame(make_stop().dump());
 		}
 	}
 
@@ -84,8 +169,22 @@ class ComputerInterface
 
 	void recieve(server::message_ptr message)
 	{
-		auto json_response = nlohmann::json::parse(message->get_payload());
-		std::cout << message->get_payload() << '\n';
+		recieve(message->get_payload());
+	}
+	void recieve(const std::string &payload)
+	{
+		TraceSpan span{"recieve", "network"};
+		m_last_heard = clock::now();
+		if (m_recorder)
+		{
+			m_recorder->record(m_connection_id, TrafficFrame::inbound, payload);
+		}
+		static auto &inbound_bytes = metrics().counter(
+		    "controller_inbound_bytes_total",
+		    "bytes received from turtles");
+		inbound_bytes.add(payload.size());
+		auto json_response = nlohmann::json::parse(payload);
+		std::cout << payload << '\n';
 		if (json_response.contains("special"))
 		{
 			if (json_response.at("special") == 1)
@@ -96,24 +195,51 @@ class ComputerInterface
 		else
 		{
 			auto response_id = json_response.at("request_id").get<int32_t>();
-			if (m_requests.find(response_id) == m_requests.end())
+			std::optional<SentRequest> request;
 			{
-				if (m_unexpected_message_handler[response_id])
+				// the scheduler thread adds requests as it sends them
+				std::scoped_lock a{request_mutex};
+				if (auto found = m_requests.find(response_id);
+				    found != m_requests.end())
 				{
-					m_unexpected_message_handler[response_id](
-					    *this,
-					    json_response["response"]);
+					request = std::move(found->second);
+					m_requests.erase(found);
+					if (request->deadline)
+					{
+						m_timers->cancel(*request->deadline);
+					}
+				}
+			}
+			if (!request)
+			{
+				// late replies to requests that timed out end up here too,
+				// looking them up mustn't add a handler for every one
+				if (auto handler = m_unexpected_message_handler.find(response_id);
+				    handler != m_unexpected_message_handler.end()
+				    && handler->second)
+				{
+					handler->second(*this, json_response["response"]);
 				}
 				else
 				{
-					std::cout << "recieved unexpected message from computer "
-					          << hash(m_connection)
+					std::cout << "recieved unexpected message " << response_id
+					          << " from computer " << hash(m_connection)
 					          << " with no registered handler\n";
 				}
 				return;
 			}
-			m_requests.at(response_id)->set_value(json_response["response"]);
-			m_requests.erase(response_id);
+			std::chrono::duration<double> latency
+			    = std::chrono::steady_clock::now() - request->sent;
+			metrics()
+			    .histogram(
+			        "controller_request_seconds",
+			        "time from sending a request to its reply",
+			        {{"type", request->type}})
+			    .observe(latency.count());
+			for (auto &promise : request->promises)
+			{
+				promise->set_value(json_response["response"]);
+			}
 		}
 	}
 
@@ -125,125 +251,183 @@ class ComputerInterface
 	}
 
 	void scheduler_internal(std::chrono::duration<double> dt)
+	{
+		Promises failed;
+		{
+			RequestLock a{*this};
+			if (m_dead)
+			{
+				return;
+			}
+			constexpr std::chrono::duration<double> threshold{0.1};
+			if (queued() != 0 && m_time_since_last_request > threshold
+			    && ready_to_send)
+			{
+				send_front_request();
+			}
+			m_time_since_last_request += dt;
+			if (m_timers)
+			{
+				failed = check_liveness();
+			}
+		}
+		fail(failed, "turtle stopped answering");
+	}
+
+	// stopped answering, everything it was asked has failed. the server drops
+	// it
+	bool dead() const { return m_dead; }
+
+	// for a type of request from now on, requests already sent keep theirs
+	void set_policy(const std::string &request_type, RequestPolicy policy)
+	{
+		std::scoped_lock a{request_mutex};
+		m_policies[request_type] = policy;
+	}
+
+	// for replays, sends the next queued request without waiting for the
+	// turtle, so the reply that follows in the capture finds it
+	void send_next_request()
 	{
 		std::scoped_lock a{request_mutex};
-		constexpr std::chrono::duration<double> threshold{0.1};
-		if (!m_request_queue.empty() && m_time_since_last_request > threshold
-		    && ready_to_send)
+		if (queued() != 0)
 		{
-			m_endpoint.send(
-			    m_connection,
-			    std::get<1>(m_request_queue.front()).dump(),
-			    websocketpp::frame::opcode::text);
-			m_requests.emplace(
-			    std::get<0>(m_request_queue.front()),
-			    std::get<2>(m_request_queue.front()));
-			m_request_queue.pop_front();
-			m_time_since_last_request = std::chrono::duration<double>{0};
-			ready_to_send = false;
+			send_front_request();
 		}
-		m_time_since_last_request += dt;
 	}
 
-	void auth_message(std::string auth)
+	uint32_t connection_id() const { return m_connection_id; }
+
+	// waiting to be sent
+	size_t queued_requests()
 	{
 		std::scoped_lock a{request_mutex};
-		auth_message_impl(auth);
+		return queued();
 	}
-	boost::future<nlohmann::json> auth_message_future(std::string auth)
+	// sent and not answered yet
+	size_t requests_in_flight()
 	{
 		std::scoped_lock a{request_mutex};
+		return m_requests.size();
+	}
+
+	// payload is request serialized, both can be shared with other computers
+	// like server_manager::broadcast does. the request id is added when sent
+	boost::future<nlohmann::json> submit_serialized(
+	    std::shared_ptr<const nlohmann::json> request,
+	    std::shared_ptr<const std::string> payload)
+	{
+		RequestLock a{*this};
+		return submit_request(std::move(request), std::move(payload))
+		    ->get_future();
+	}
+
+	// what is sent after the request id. the make_* requests have a
+	// placeholder id for when they are put in a buffer, which would come
+	// after the real one and win
+	static std::string serialize_request(nlohmann::json &request)
+	{
+		request.erase("request_id");
+		return request.dump();
+	}
+
+	// the request a buffer is sent as, before it gets a request id
+	template <typename T>
+	static nlohmann::json make_command_buffer_json(CommandBuffer<T> &);
+
+	void auth_message(std::string auth)
+	{
+		RequestLock a{*this};
 		auth_message_impl(auth);
-		return std::get<2>(m_request_queue.back())->get_future();
+	}
+	boost::future<nlohmann::json> auth_message_future(std::string auth)
+	{
+		RequestLock a{*this};
+		return auth_message_impl(auth)->get_future();
 	}
 	void remote_eval(std::string to_eval)
 	{
-		std::scoped_lock a{request_mutex};
+		RequestLock a{*this};
 		remote_eval_impl(to_eval);
 	}
 	boost::future<nlohmann::json> remote_eval_future(std::string to_eval)
 	{
-		std::scoped_lock a{request_mutex};
-		remote_eval_impl(to_eval);
-		return std::get<2>(m_request_queue.back())->get_future();
+		RequestLock a{*this};
+		return remote_eval_impl(to_eval)->get_future();
 	}
 	template <typename T>
 	void execute_buffer(CommandBuffer<T> &buffer)
 	{
-		std::scoped_lock a{request_mutex};
+		RequestLock a{*this};
 		execute_buffer_impl<T>(buffer);
 	}
 	template <typename T>
 	boost::future<T> execute_buffer_future(CommandBuffer<T> &buffer)
 	{
-		std::scoped_lock a{request_mutex};
-		execute_buffer_impl<T>(buffer);
+		RequestLock a{*this};
+		auto promise = execute_buffer_impl<T>(buffer);
 		auto parser = buffer.get_output_parser();
-		return std::get<2>(m_request_queue.back())
-		    ->get_future()
-		    .then([parser](boost::future<nlohmann::json> f) {
-			    return parser(f.get());
-		    });
+		// parsed on the thread that gets the reply, not one of its own
+		return promise->get_future().then(
+		        boost::launch::sync,
+		        [parser](boost::future<nlohmann::json> f) {
+			        return parser(f.get());
+		        });
 	}
 	void inspect(std::string direction)
 	{
-		std::scoped_lock a{request_mutex};
+		RequestLock a{*this};
 		inspect_impl(direction);
 	}
 	boost::future<nlohmann::json> inspect_future(std::string direction)
 	{
-		std::scoped_lock a{request_mutex};
-		inspect_impl(direction);
-		return std::get<2>(m_request_queue.back())->get_future();
+		RequestLock a{*this};
+		return inspect_impl(direction)->get_future();
 	}
 	void rotate(std::string direction)
 	{
-		std::scoped_lock a{request_mutex};
+		RequestLock a{*this};
 		rotate_impl(direction);
 	}
 	boost::future<nlohmann::json> rotate_future(std::string direction)
 	{
-		std::scoped_lock a{request_mutex};
-		rotate_impl(direction);
-		return std::get<2>(m_request_queue.back())->get_future();
+		RequestLock a{*this};
+		return rotate_impl(direction)->get_future();
 	}
 	void move(std::string direction)
 	{
-		std::scoped_lock a{request_mutex};
+		RequestLock a{*this};
 		move_impl(direction);
 	}
 	boost::future<nlohmann::json> move_future(std::string direction)
 	{
-		std::scoped_lock a{request_mutex};
-		move_impl(direction);
-		return std::get<2>(m_request_queue.back())->get_future();
+		RequestLock a{*this};
+		return move_impl(direction)->get_future();
 	}
 	auto inventory(bool detailed = true)
 	{
-		std::scoped_lock a{request_mutex};
+		RequestLock a{*this};
 		inventory_impl(detailed);
 	}
 	auto inventory_future(bool detailed = true)
 	{
-		std::scoped_lock a{request_mutex};
-		inventory_impl(detailed);
-		return std::get<2>(m_request_queue.back())->get_future();
+		RequestLock a{*this};
+		return inventory_impl(detailed)->get_future();
 	}
 	auto inventory_slot(int slot, bool detailed = true)
 	{
-		std::scoped_lock a{request_mutex};
+		RequestLock a{*this};
 		inventory_slot_impl(slot, detailed);
 	}
 	auto inventory_slot_future(int slot, bool detailed = true)
 	{
-		std::scoped_lock a{request_mutex};
-		inventory_slot_impl(slot, detailed);
-		return std::get<2>(m_request_queue.back())->get_future();
+		RequestLock a{*this};
+		return inventory_slot_impl(slot, detailed)->get_future();
 	}
 	auto
 	inventory_move(int from, int to, std::optional<int> amount = std::nullopt)
 	{
-		std::scoped_lock a{request_mutex};
+		RequestLock a{*this};
 		inventory_move_impl(from, to, amount);
 	}
 	auto inventory_move_future(
@@ -251,16 +435,15 @@ class ComputerInterface
 	    int to,
 	    std::optional<int> amount = std::nullopt)
 	{
-		std::scoped_lock a{request_mutex};
-		inventory_move_impl(from, to, amount);
-		return std::get<2>(m_request_queue.back())->get_future();
+		RequestLock a{*this};
+		return inventory_move_impl(from, to, amount)->get_future();
 	}
 	auto drop_item(
 	    int slot,
 	    std::string direction,
 	    std::optional<int> amount = std::nullopt)
 	{
-		std::scoped_lock a{request_mutex};
+		RequestLock a{*this};
 		drop_item_impl(slot, direction, amount);
 	}
 	auto drop_item_future(
@@ -268,121 +451,460 @@ class ComputerInterface
 	    std::string direction,
 	    std::optional<int> amount = std::nullopt)
 	{
-		std::scoped_lock a{request_mutex};
-		drop_item_impl(slot, direction, amount);
-		return std::get<2>(m_request_queue.back())->get_future();
+		RequestLock a{*this};
+		return drop_item_impl(slot, direction, amount)->get_future();
 	}
 	auto pickup_item(std::string direction)
 	{
-		std::scoped_lock a{request_mutex};
+		RequestLock a{*this};
 		pickup_item_impl(direction);
 	}
 	auto pickup_item_future(std::string direction)
 	{
-		std::scoped_lock a{request_mutex};
-		pickup_item_impl(direction);
-		return std::get<2>(m_request_queue.back())->get_future();
+		RequestLock a{*this};
+		return pickup_item_impl(direction)->get_future();
 	}
 	auto place_block(std::string direction, int slot)
 	{
-		std::scoped_lock a{request_mutex};
+		RequestLock a{*this};
 		place_block_impl(direction, slot);
 	}
 	auto place_block_future(std::string direction, int slot)
 	{
-		std::scoped_lock a{request_mutex};
-		place_block_impl(direction, slot);
-		return std::get<2>(m_request_queue.back())->get_future();
+		RequestLock a{*this};
+		return place_block_impl(direction, slot)->get_future();
 	}
 	auto break_block(std::string direction)
 	{
-		std::scoped_lock a{request_mutex};
+		RequestLock a{*this};
 		break_block_impl(direction);
 	}
 	auto break_block_future(std::string direction)
 	{
-		std::scoped_lock a{request_mutex};
-		break_block_impl(direction);
-		return std::get<2>(m_request_queue.back())->get_future();
+		RequestLock a{*this};
+		return break_block_impl(direction)->get_future();
 	}
 
 	private:
-	void auth_message_impl(std::string auth)
+	// the id goes in front of the request serialized without one, so the
+	// same payload can be sent again and to other computers without being
+	// serialized again or copied into a frame of its own first
+	void send_request(size_t id, const std::string &payload)
+	{
+		auto header = "{\"request_id\":" + std::to_string(id)
+		              + (payload.size() > 2 ? "," : "");
+		if (m_recorder)
+		{
+			m_recorder->record(
+			    m_connection_id,
+			    TrafficFrame::outbound,
+			    header + payload.substr(1));
+		}
+		// a replay has no connection to send to
+		websocketpp::lib::error_code error;
+		auto connection = m_endpoint.get_con_from_hdl(m_connection, error);
+		if (error)
+		{
+			return;
+		}
+		auto message = connection->get_message(
+		    websocketpp::frame::opcode::text,
+		    header.size() + payload.size() - 1);
+		message->append_payload(header);
+		message->append_payload(payload.data() + 1, payload.size() - 1);
+		connection->send(message);
+	}
+
+	void send_frame(const std::string &payload)
+	{
+		if (m_recorder)
+		{
+			m_recorder->record(m_connection_id, TrafficFrame::outbound, payload);
+		}
+		// a replay has no connection to send to
+		websocketpp::lib::error_code error;
+		m_endpoint.send(
+		    m_connection,
+		    payload,
+		    websocketpp::frame::opcode::text,
+		    error);
+	}
+
+	// call with something queued
+	void send_front_request()
+	{
+		size_t lane = 0;
+		while (m_lanes[lane].empty())
+		{
+			lane++;
+		}
+		auto [id, request, payload, promises, attempt, collapse_key]
+		    = std::move(m_lanes[lane].front());
+		m_lanes[lane].pop_front();
+		send_request(id, *payload);
+		auto type = request->value("request_type", "");
+		std::optional<TimerWheel::id> deadline;
+		if (m_timers)
+		{
+			deadline = m_timers->schedule(
+			    clock::now() + timeout_for(type, *request),
+			    [self = weak_from_this(), request_id = id]() {
+				    if (auto computer = self.lock())
+				    {
+					    computer->request_timed_out(request_id);
+				    }
+			    });
+		}
+		m_requests.emplace(
+		    id,
+		    SentRequest{
+		        std::move(promises),
+		        std::move(type),
+		        clock::now(),
+		        std::move(request),
+		        std::move(payload),
+		        static_cast<RequestLane>(lane),
+		        attempt,
+		        deadline});
+		m_time_since_last_request = std::chrono::duration<double>{0};
+		ready_to_send = false;
+	}
+
+	const RequestPolicy &policy_for(const std::string &type) const
+	{
+		auto found = m_policies.find(type);
+		return found != m_policies.end() ? found->second : default_policy;
+	}
+
+	std::chrono::milliseconds
+	timeout_for(const std::string &type, const nlohmann::json &request) const
+	{
+		auto timeout = policy_for(type).timeout;
+		if (auto commands = request.find("commands"); commands != request.end())
+		{
+			timeout += per_command_timeout * commands->size();
+		}
+		return timeout;
+	}
+
+	// runs on the thread advancing the timers
+	void request_timed_out(size_t request_id)
+	{
+		Promises failed;
+		{
+			std::scoped_lock a{request_mutex};
+			auto found = m_requests.find(request_id);
+			if (found == m_requests.end())
+			{
+				return;
+			}
+			auto request = std::move(found->second);
+			m_requests.erase(found);
+			metrics()
+			    .counter(
+			        "controller_request_timeouts_total",
+			        "requests a turtle didn't answer in time",
+			        {{"type", request.type}})
+			    .add();
+			if (request.attempt < policy_for(request.type).retries)
+			{
+				metrics()
+				    .counter(
+				        "controller_request_retries_total",
+				        "requests sent again after timing out",
+				        {{"type", request.type}})
+				    .add();
+				// under a new id so a late reply to the lost one is ignored.
+				// it is sent when the turtle asks for the next request, one
+				// that never does is dropped after ready_timeout
+				m_lanes[static_cast<size_t>(request.lane)].push_front(
+				    {get_id(),
+				     std::move(request.request),
+				     std::move(request.payload),
+				     std::move(request.promises),
+				     request.attempt + 1,
+				     {}});
+				return;
+			}
+			mark_dead("its " + request.type + " request timed out");
+			failed = take_waiting();
+			failed.insert(
+			    failed.end(),
+			    request.promises.begin(),
+			    request.promises.end());
+		}
+		fail(failed, "turtle stopped answering");
+	}
+
+	// call with a RequestLock, only when requests have deadlines
+	Promises
+	check_liveness()
+	{
+		auto silent = clock::now() - m_last_heard.load();
+		if (queued() == 0 && m_requests.empty())
+		{
+			// its deadline finds out if it is still there
+			if (ready_to_send && silent > heartbeat_interval)
+			{
+				submit_request(
+				    make_eval("return true"),
+				    RequestLane::background);
+			}
+		}
+		else if (m_requests.empty() && !ready_to_send && silent > ready_timeout)
+		{
+			mark_dead("it never asked for the next request");
+			return take_waiting();
+		}
+		return {};
+	}
+
+	// request_mutex for anything that can submit a request. a request
+	// rejected for a full lane is failed after letting go of it, so what runs
+	// on its future doesn't run under it
+	class RequestLock
+	{
+		public:
+		explicit RequestLock(ComputerInterface &computer)
+		    : m_computer(computer), m_lock(computer.request_mutex)
+		{
+		}
+		~RequestLock()
+		{
+			auto rejected = std::move(m_computer.m_rejected);
+			m_computer.m_rejected.clear();
+			m_lock.unlock();
+			fail(rejected, "too many requests queued for the turtle");
+		}
+		RequestLock(const RequestLock &) = delete;
+		RequestLock &operator=(const RequestLock &) = delete;
+
+		private:
+		ComputerInterface &m_computer;
+		std::unique_lock<std::mutex> m_lock;
+	};
+
+	// call with request_mutex
+	void mark_dead(const std::string &why)
+	{
+		m_dead = true;
+		std::cout << "dropping computer " << m_connection_id << ", " << why
+		          << '\n';
+	}
+
+	// everything the turtle was asked and didn't answer, to fail once
+	// request_mutex is let go. call with request_mutex
+	Promises
+	take_waiting()
+	{
+		Promises waiting;
+		for (auto &lane : m_lanes)
+		{
+			for (auto &queued : lane)
+			{
+				waiting.insert(
+				    waiting.end(),
+				    queued.promises.begin(),
+				    queued.promises.end());
+			}
+			lane.clear();
+		}
+		for (auto &[id, request] : m_requests)
+		{
+			waiting.insert(
+			    waiting.end(),
+			    request.promises.begin(),
+			    request.promises.end());
+		}
+		m_requests.clear();
+		return waiting;
+	}
+
+	static void fail(
+	    Promises &promises,
+	    const std::string &why)
+	{
+		for (auto &promise : promises)
+		{
+			promise->set_value({{"error", why}});
+		}
+	}
+
+	Promise auth_message_impl(std::string auth)
 	{
 		auto request = make_auth(auth);
-		submit_request(request);
+		return submit_request(request);
 	}
 
-	void remote_eval_impl(std::string to_eval)
+	Promise remote_eval_impl(std::string to_eval)
 	{
 		auto request = make_eval(to_eval);
-		submit_request(request);
+		return submit_request(request);
 	}
 
 	template <typename T>
-	void execute_buffer_impl(CommandBuffer<T> &buffer);
+	Promise execute_buffer_impl(CommandBuffer<T> &buffer);
 
-	void inspect_impl(std::string direction)
+	Promise inspect_impl(std::string direction)
 	{
 		auto request = make_inspect(direction);
-		submit_request(request);
+		return submit_request(request);
 	}
-	void rotate_impl(std::string direction)
+	Promise rotate_impl(std::string direction)
 	{
 		auto request = make_rotate(direction);
-		submit_request(request);
+		return submit_request(request);
 	}
-	void move_impl(std::string direction)
+	Promise move_impl(std::string direction)
 	{
 		auto request = make_move(direction);
-		submit_request(request);
+		return submit_request(request);
 	}
-	void inventory_impl(bool detailed = true)
+	Promise inventory_impl(bool detailed = true)
 	{
 		auto request = make_inventory(detailed);
-		submit_request(request);
+		return submit_request(request);
 	}
-	void inventory_slot_impl(int slot, bool detailed = true)
+	Promise inventory_slot_impl(int slot, bool detailed = true)
 	{
 		auto request = make_inventory_slot(slot, detailed);
-		submit_request(request);
+		return submit_request(request);
 	}
-	void inventory_move_impl(
+	Promise inventory_move_impl(
 	    int from,
 	    int to,
 	    std::optional<int> amount = std::nullopt)
 	{
 		auto request = make_inventory_move(from, to, amount);
-		submit_request(request);
+		return submit_request(request);
 	}
-	void drop_item_impl(
+	Promise drop_item_impl(
 	    int slot,
 	    std::string direction,
 	    std::optional<int> amount = std::nullopt)
 	{
 		auto request = make_drop_item(slot, direction, amount);
-		submit_request(request);
+		return submit_request(request);
+	}
+	Promise pickup_item_impl(std::string direction)
+	{
+		return submit_request(make_pickup_item(direction));
 	}
-	void pickup_item_impl(std::string direction)
+	Promise place_block_impl(std::string direction, int slot)
 	{
-		submit_request(make_pickup_item(direction));
+		return submit_request(make_place_block(direction, slot));
+	}
+	Promise break_block_impl(std::string direction)
+	{
+		return submit_request(make_break_block(direction));
+	}
+
+	// one the same still waiting in the lane answers this one too if asking
+	// changes nothing. a full lane fails the request straight away, that is
+	// how whoever asked finds out to slow down
+	Promise submit_request(
+	    nlohmann::json request,
+	    RequestLane lane = RequestLaneScope::current())
+	{
+		auto payload
+		    = std::make_shared<const std::string>(serialize_request(request));
+		return submit_request(
+		    std::make_shared<const nlohmann::json>(std::move(request)),
+		    std::move(payload),
+		    lane);
+	}
+	Promise submit_request(
+	    std::shared_ptr<const nlohmann::json> request,
+	    std::shared_ptr<const std::string> payload,
+	    RequestLane lane = RequestLaneScope::current())
+	{
+		// send_request puts the id in front
+		assert(!request->contains("request_id"));
+		auto promise = std::make_shared<boost::promise<nlohmann::json>>();
+		auto &queue = m_lanes[static_cast<size_t>(lane)];
+		std::string collapse_key;
+		if (collapsible(*request))
+		{
+			collapse_key = *payload;
+			for (auto &queued : queue)
+			{
+				if (queued.collapse_key == collapse_key)
+				{
+					queued.promises.push_back(promise);
+					metrics()
+					    .counter(
+					        "controller_requests_collapsed_total",
+					        "requests answered by one the same already queued",
+					        {{"lane", lane_name(lane)}})
+					    .add();
+					return promise;
+				}
+			}
+		}
+		if (reject_if_full(lane, promise))
+		{
+			return promise;
+		}
+		queue.push_back(
+		    {get_id(),
+		     std::move(request),
+		     std::move(payload),
+		     {promise},
+		     0,
+		     collapse_key});
+		return promise;
 	}
-	void place_block_impl(std::string direction, int slot)
+
+	// fails promise once request_mutex is let go if the lane can't take any
+	// more. call with a RequestLock
+	bool reject_if_full(RequestLane lane, const Promise &promise)
 	{
-		submit_request(make_place_block(direction, slot));
+		if (m_lanes[static_cast<size_t>(lane)].size()
+		    < lane_capacity[static_cast<size_t>(lane)])
+		{
+			return false;
+		}
+		metrics()
+		    .counter(
+		        "controller_requests_rejected_total",
+		        "requests failed because their lane was full",
+		        {{"lane", lane_name(lane)}})
+		    .add();
+		m_rejected.push_back(promise);
+		return true;
 	}
-	void break_block_impl(std::string direction)
+
+	// asking for it changes nothing on the turtle
+	static bool collapsible(const nlohmann::json &request)
 	{
-		submit_request(make_break_block(direction));
+		auto type = request.value("request_type", "");
+		if (type == "inspect" || type == "inventory" || type == "inventory_slot")
+		{
+			return true;
+		}
+		if (type != "command buffer" || request.at("commands").empty())
+		{
+			return false;
+		}
+		for (auto &command : request.at("commands"))
+		{
+			if (!collapsible(command))
+			{
+				return false;
+			}
+		}
+		return true;
 	}
 
-	void submit_request(nlohmann::json request)
+	// call with request_mutex
+	size_t queued() const
 	{
-		auto request_id = add_request_id(request);
-		m_request_queue.emplace_back(
-		    request_id,
-		    request,
-		    std::make_shared<boost::promise<nlohmann::json>>());
+		size_t count = 0;
+		for (auto &lane : m_lanes)
+		{
+			count += lane.size();
+		}
+		return count;
 	}
 
 	static nlohmann::json make_auth(std::string auth)
@@ -417,14 +939,12 @@ class ComputerInterface
 		)"_json;
 		return stop;
 	}
-	template <typename T>
-	static nlohmann::json make_command_buffer_json(CommandBuffer<T> &);
 	static nlohmann::json make_inspect(std::string direction)
 	{
 		auto inspect = R"(
 			{
 				"request_type": "inspect",
-				"request_id": "-1",
+				"request_id": -1,
 				"direction": ""
 			}
 		)"_json;
@@ -562,29 +1082,54 @@ class ComputerInterface
 		return break_block;
 	}
 
-	size_t add_request_id(nlohmann::json &request)
-	{
-		request["request_id"] = get_id();
-		return request.at("request_id");
-	}
-
 	size_t get_id() { return m_request_id_counter++; }
 	size_t m_request_id_counter = 1;
 	websocketpp::connection_hdl m_connection;
 	server &m_endpoint;
-	std::deque<std::tuple<
-	    size_t,
-	    nlohmann::json,
-	    std::shared_ptr<boost::promise<nlohmann::json>>>>
-	    m_request_queue;
-	std::unordered_map<size_t, std::shared_ptr<boost::promise<nlohmann::json>>>
-	    m_requests;
+	std::shared_ptr<TrafficRecorder> m_recorder;
+	uint32_t m_connection_id;
+	TimerWheel *m_timers;
+	struct QueuedRequest
+	{
+		size_t id;
+		// without its id, shared with the other computers a broadcast goes
+		// to and with every other send of the same CommandBuffer
+		std::shared_ptr<const nlohmann::json> request;
+		// request serialized, what is sent after the id
+		std::shared_ptr<const std::string> payload;
+		// more than one when asked for again before it was sent
+		Promises promises;
+		// how many times it was sent before
+		int attempt;
+		// the request without its id if it is collapsible, empty otherwise
+		std::string collapse_key;
+	};
+	std::array<std::deque<QueuedRequest>, request_lane_count> m_lanes;
+	struct SentRequest
+	{
+		Promises promises;
+		std::string type;
+		clock::time_point sent;
+		// kept to send again, at the front of its lane
+		std::shared_ptr<const nlohmann::json> request;
+		std::shared_ptr<const std::string> payload;
+		RequestLane lane;
+		int attempt;
+		std::optional<TimerWheel::id> deadline;
+	};
+	std::unordered_map<size_t, SentRequest> m_requests;
+	std::unordered_map<std::string, RequestPolicy> m_policies;
 	std::map<int32_t, std::function<void(ComputerInterface &, nlohmann::json)>>
 	    m_unexpected_message_handler;
 
 	std::chrono::duration<double> m_time_since_last_request{1e100};
 	std::mutex request_mutex;
+	// rejected for a full lane, failed when the RequestLock holding
+	// request_mutex lets go of it
+	Promises m_rejected;
 	std::atomic<bool> ready_to_send = false;
+	std::atomic<clock::time_point> m_last_heard = clock::now();
+	std::atomic<bool> m_dead = false;
 
 	template <typename T>
 	friend class CommandBuffer;
@@ -607,59 +1152,71 @@ class CommandBuffer
 			SetDefaultParser();
 		}
 	}
+	CommandBuffer(const CommandBuffer &other)
+	    : m_output_parser(other.m_output_parser), m_commands(other.m_commands),
+	      m_serialized(other.m_serialized.load())
+	{
+	}
+	CommandBuffer &operator=(const CommandBuffer &other)
+	{
+		m_output_parser = other.m_output_parser;
+		m_commands = other.m_commands;
+		m_serialized = other.m_serialized.load();
+		return *this;
+	}
 
 	void auth(std::string m)
 	{
 		CheckShutdown();
-		m_commands.at("commands").push_back(ComputerInterface::make_auth(m));
+		changed().at("commands").push_back(ComputerInterface::make_auth(m));
 	}
 	void eval(std::string m)
 	{
 		CheckShutdown();
-		m_commands.at("commands").push_back(ComputerInterface::make_eval(m));
+		changed().at("commands").push_back(ComputerInterface::make_eval(m));
 	}
 	template <typename Q>
 	void buffer(CommandBuffer<Q> &m)
 	{
 		CheckShutdown();
-		m_commands.at("commands")
+		changed().at("commands")
 		    .push_back(ComputerInterface::make_command_buffer_json(m));
 	}
 	void inspect(std::string direction)
 	{
 		CheckShutdown();
-		m_commands.at("commands")
+		changed().at("commands")
 		    .push_back(ComputerInterface::make_inspect(direction));
 	}
 	void rotate(std::string direction)
 	{
 		CheckShutdown();
-		m_commands.at("commands")
+		changed().at("commands")
 		    .push_back(ComputerInterface::make_rotate(direction));
 	}
 	void move(std::string direction)
 	{
 		CheckShutdown();
-		m_commands.at("commands")
+		changed().at("commands")
 		    .push_back(ComputerInterface::make_move(direction));
 	}
 	void inventory(bool detailed = true)
 	{
 		CheckShutdown();
-		m_commands.at("commands")
+		changed().at("commands")
 		    .push_back(ComputerInterface::make_inventory(detailed));
 	}
 	void inventory_slot(int slot, bool detailed = true)
 	{
 		CheckShutdown();
-		m_commands.at("commands")
+		changed().at("commands")
 		    .push_back(ComputerInterface::make_inventory_slot(slot, detailed));
 	}
 	void
 	inventory_move(int from, int to, std::optional<int> amount = std::nullopt)
 	{
 		CheckShutdown();
-		m_commands.at("commands")
+		changed().at("commands")
 		    .push_back(ComputerInterface::make_inventory_move(from, to, amount));
 	}
 	void drop_item(
@@ -668,34 +1225,42 @@ class CommandBuffer
 	    std::optional<int> amount = std::nullopt)
 	{
 		CheckShutdown();
-		m_commands.at("commands")
+		changed().at("commands")
 		    .push_back(
 		        ComputerInterface::make_drop_item(slot, direction, amount));
 	}
 	void pickup_item(std::string direction)
 	{
 		CheckShutdown();
-		m_commands.at("commands")
+		changed().at("commands")
 		    .push_back(ComputerInterface::make_pickup_item(direction));
 	}
 	void place_block(std::string direction, int slot)
 	{
 		CheckShutdown();
-		m_commands.at("commands")
+		changed().at("commands")
 		    .push_back(ComputerInterface::make_place_block(direction, slot));
 	}
 	void break_block(std::string direction)
 	{
 		CheckShutdown();
-		m_commands.at("commands")
+		changed().at("commands")
 		    .push_back(ComputerInterface::make_break_block(direction));
 	}
 	constexpr void stop()
 	{
-		m_commands.at("commands").push_back(ComputerInterface::make_stop());
+		changed().at("commands").push_back(ComputerInterface::make_stop());
 		m_commands["shutdown"] = true;
 	}
 
+	// the turtle stops at the first command that fails and only returns the
+	// results up to and including that one
+	void abort_on_failure(bool abort = true)
+	{
+		changed()["abort_on_failure"] = abort;
+	}
+	size_t size() const { return m_commands.at("commands").size(); }
+
 	constexpr void SupplyOutputParser(std::function<T(nlohmann::json)> m)
 	{
 		m_output_parser = m;
@@ -705,6 +1270,31 @@ class CommandBuffer
 		m_output_parser = [](nlohmann::json m) -> nlohmann::json { return m; };
 	}
 
+	struct Serialized
+	{
+		std::shared_ptr<const nlohmann::json> request;
+		// request as text, without a request id
+		std::shared_ptr<const std::string> payload;
+	};
+	// what the buffer is sent as, made the first time it is sent after a
+	// change and shared by every send until the next one. buffers that never
+	// change, like Turtle::forward_0, are only ever serialized once even when
+	// many threads send them at the same time
+	std::shared_ptr<const Serialized> serialized()
+	{
+		auto serialized = m_serialized.load();
+		if (!serialized)
+		{
+			auto request = std::make_shared<const nlohmann::json>(
+			    ComputerInterface::make_command_buffer_json(*this));
+			auto payload = std::make_shared<const std::string>(request->dump());
+			serialized = std::make_shared<const Serialized>(
+			    Serialized{std::move(request), std::move(payload)});
+			m_serialized = serialized;
+		}
+		return serialized;
+	}
+
 	private:
 	std::function<T(nlohmann::json)> get_output_parser()
 	{
@@ -718,8 +1308,16 @@ class CommandBuffer
 			             "be executed\n";
 		}
 	}
+	// everything changing the commands goes through here
+	nlohmann::json &changed()
+	{
+		m_serialized.store(nullptr);
+		return m_commands;
+	}
+
 	std::function<T(nlohmann::json)> m_output_parser;
 	nlohmann::json m_commands;
+	std::atomic<std::shared_ptr<const Serialized>> m_serialized;
 
 	friend class ComputerInterface;
 };
@@ -734,12 +1332,9 @@ ComputerInterface::make_command_buffer_json(CommandBuffer<T> &buffer)
 }
 
 template <typename T>
-void ComputerInterface::execute_buffer_impl(CommandBuffer<T> &buffer)
+ComputerInterface::Promise
+ComputerInterface::execute_buffer_impl(CommandBuffer<T> &buffer)
 {
-	auto request = make_command_buffer_json(buffer);
-	auto request_id = add_request_id(request);
-	m_request_queue.emplace_back(
-	    request_id,
-	    request,
-	    std::make_shared<boost::promise<nlohmann::json>>());
+	auto serialized = buffer.serialized();
+	return submit_request(serialized->request, serialized->payload);
 }
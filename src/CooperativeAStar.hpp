@@ -0,0 +1,228 @@
+#pragma once
+
+#include <array>
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <glm/ext.hpp>
+#include <glm/gtx/hash.hpp>
+
+#include "Planner.hpp"
+#include "ReservationTable.hpp"
+
+// windowed hierarchical cooperative A*, searches in (x, y, z, t) against the
+// reservations of other turtles and only looks `window` steps ahead, the
+// remainder of the trip is planned once the turtle reaches the end of the
+// window. waiting in place is a valid move, so results can repeat positions
+// and a goal that can't be reached still gives a partial result, whoever
+// searches has to notice the windows getting no closer
+class CooperativeAStar : public Planner
+{
+	public:
+	constexpr static int default_window = 16;
+
+	CooperativeAStar(
+	    glm::ivec3 start,
+	    glm::ivec3 end,
+	    std::function<bool(glm::ivec3)> obstacle,
+	    ReservationTable &reservations,
+	    std::string owner,
+	    int window = default_window,
+	    std::optional<std::vector<glm::ivec3>> cached_route = std::nullopt)
+	    : m_start(start), m_end(end), m_obstacle(obstacle),
+	      m_reservations(reservations), m_owner(owner), m_window(window),
+	      m_cached_route(std::move(cached_route))
+	{
+		if (m_obstacle(end) && !(start == end))
+		{
+			guaranteed_impossible = true;
+		}
+	}
+
+	bool run() override
+	{
+		if (guaranteed_impossible)
+		{
+			return false;
+		}
+		// a remembered route is good enough if nobody has reserved anything
+		// along it, no need to search at all then
+		if (m_cached_route && !m_cached_route->empty()
+		    && m_cached_route->front() == m_start)
+		{
+			int start_time = m_reservations.now();
+			if (m_reservations.try_reserve(
+			        m_owner,
+			        *m_cached_route,
+			        start_time))
+			{
+				m_path = *m_cached_route;
+				m_reserved_from = start_time;
+				return true;
+			}
+		}
+		// another turtle can reserve a conflicting path while this one is
+		// searching, so search again against the updated table if that happens
+		constexpr int max_attempts = 4;
+		for (int attempt = 0; attempt < max_attempts && !stop; attempt++)
+		{
+			int start_time = m_reservations.now();
+			if (!search(start_time))
+			{
+				return false;
+			}
+			if (m_reservations.try_reserve(m_owner, m_path, start_time))
+			{
+				m_reserved_from = start_time;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool obstacle(glm::ivec3 pos) override
+	{
+		return m_obstacle(pos)
+		       || m_reservations.is_resting_elsewhere(pos, m_owner);
+	}
+
+	std::vector<glm::ivec3> path_result() override { return m_path; }
+	const char *name() const override { return "cooperative"; }
+
+	// true if the result stops at the edge of the window instead of the goal
+	bool partial() const override { return m_partial; }
+	// the step the first position of the result is reserved at
+	int reserved_from() const { return m_reserved_from; }
+
+	private:
+	struct Node
+	{
+		int g;
+		SpaceTime parent;
+		bool has_parent;
+	};
+
+	bool search(int start_time)
+	{
+		m_nodes.clear();
+		m_closed.clear();
+		m_open.clear();
+		m_path.clear();
+		m_partial = false;
+
+		SpaceTime start{m_start, start_time};
+		m_nodes[start] = Node{0, start, false};
+		m_open.insert({{heuristic(m_start), 0}, start});
+
+		while (!stop)
+		{
+			if (m_open.empty())
+			{
+				return false;
+			}
+			auto candidate = m_open.begin();
+			auto current = candidate->second;
+			m_open.erase(candidate);
+			if (!m_closed.insert(current).second)
+			{
+				continue;
+			}
+			expanded_nodes++;
+			if (current.position == m_end
+			    && m_reservations.can_rest(m_end, current.time, m_owner))
+			{
+				build_path(current);
+				return true;
+			}
+			if (current.time - start_time >= m_window)
+			{
+				build_path(current);
+				m_partial = true;
+				return true;
+			}
+			int g = m_nodes.at(current).g;
+			constexpr std::array<glm::ivec3, 7> moves{
+			    glm::ivec3{0, 0, 0},
+			    glm::ivec3{-1, 0, 0},
+			    glm::ivec3{1, 0, 0},
+			    glm::ivec3{0, -1, 0},
+			    glm::ivec3{0, 1, 0},
+			    glm::ivec3{0, 0, -1},
+			    glm::ivec3{0, 0, 1}};
+			for (auto &move : moves)
+			{
+				SpaceTime next{current.position + move, current.time + 1};
+				if (m_closed.contains(next))
+				{
+					continue;
+				}
+				if (move != glm::ivec3{0, 0, 0} && m_obstacle(next.position))
+				{
+					continue;
+				}
+				if (!m_reservations.can_move(
+				        current.position,
+				        next.position,
+				        current.time,
+				        m_owner))
+				{
+					continue;
+				}
+				if (auto already = m_nodes.find(next);
+				    already != m_nodes.end() && already->second.g <= g + 1)
+				{
+					continue;
+				}
+				m_nodes[next] = Node{g + 1, current, true};
+				// prefer deeper nodes on ties, they are closer to the goal
+				m_open.insert(
+				    {{g + 1 + heuristic(next.position), -(g + 1)}, next});
+			}
+		}
+		return false;
+	}
+
+	int heuristic(glm::ivec3 position)
+	{
+		auto distance_diff = glm::abs(position - m_end);
+		return distance_diff.x + distance_diff.y + distance_diff.z;
+	}
+
+	void build_path(SpaceTime end)
+	{
+		std::vector<glm::ivec3> reversed;
+		auto current = end;
+		while (true)
+		{
+			reversed.push_back(current.position);
+			auto &node = m_nodes.at(current);
+			if (!node.has_parent)
+			{
+				break;
+			}
+			current = node.parent;
+		}
+		m_path.assign(reversed.rbegin(), reversed.rend());
+	}
+
+	bool guaranteed_impossible = false;
+	bool m_partial = false;
+	int m_reserved_from = 0;
+
+	glm::ivec3 m_start;
+	glm::ivec3 m_end;
+	std::function<bool(glm::ivec3)> m_obstacle;
+	ReservationTable &m_reservations;
+	std::string m_owner;
+	int m_window;
+	std::optional<std::vector<glm::ivec3>> m_cached_route;
+
+	std::multimap<std::pair<int, int>, SpaceTime> m_open;
+	std::unordered_map<SpaceTime, Node> m_nodes;
+	std::unordered_set<SpaceTime> m_closed;
+	std::vector<glm::ivec3> m_path;
+};
@@ -1,10 +1,137 @@
 #include "GUI.hpp"
 
+#include <chrono>
 #include <fstream>
+#include <map>
 
 #include "imgui.h"
 #include "misc/cpp/imgui_stdlib.h"
 
+#include "Metrics.hpp"
+#include "Trace.hpp"
+
+// counters are shown with how fast they went up over the last second,
+// histograms with their mean and percentiles in milliseconds
+void draw_metrics()
+{
+	using clock = std::chrono::steady_clock;
+	struct Rate
+	{
+		double last_value = 0;
+		clock::time_point last_time;
+		double per_second = 0;
+	};
+	static std::map<std::string, Rate> rates;
+	auto now = clock::now();
+
+	ImGui::TextUnformatted("also served as prometheus text on /metrics");
+	for (auto &family : metrics().read())
+	{
+		if (family.series.empty())
+		{
+			continue;
+		}
+		bool open = ImGui::TreeNode(family.name.c_str());
+		if (ImGui::IsItemHovered())
+		{
+			ImGui::SetTooltip("%s", family.help.c_str());
+		}
+		if (!open)
+		{
+			continue;
+		}
+		for (auto &series : family.series)
+		{
+			auto labels = Metrics::format_labels(series.labels);
+			switch (family.kind)
+			{
+			case Metrics::counter_kind:
+			{
+				auto &rate = rates[family.name + labels];
+				std::chrono::duration<double> since = now - rate.last_time;
+				if (since.count() >= 1)
+				{
+					rate.per_second
+					    = (series.value - rate.last_value) / since.count();
+					rate.last_value = series.value;
+					rate.last_time = now;
+				}
+				ImGui::Text(
+				    "%s %.0f, %.1f/s",
+				    labels.c_str(),
+				    series.value,
+				    rate.per_second);
+				break;
+			}
+			case Metrics::gauge_kind:
+				ImGui::Text("%s %g", labels.c_str(), series.value);
+				break;
+			case Metrics::histogram_kind:
+				ImGui::Text(
+				    "%s %llu, mean %.2f p50 %.2f p99 %.2f",
+				    labels.c_str(),
+				    static_cast<unsigned long long>(series.count),
+				    series.count ? series.sum / series.count * 1000 : 0,
+				    series.quantile(family.bounds, 0.5) * 1000,
+				    series.quantile(family.bounds, 0.99) * 1000);
+				break;
+			}
+		}
+		ImGui::TreePop();
+	}
+}
+
+// one eval to every connected turtle, or the ones on a server and in a
+// dimension, and how many of them answered
+void draw_broadcast(World &world, server_manager &s)
+{
+	static std::string eval_text;
+	static std::string server;
+	static std::string dimension;
+	static std::optional<boost::future<std::vector<BroadcastReply>>> pending;
+	static std::vector<BroadcastReply> replies;
+	ImGui::InputTextMultiline("broadcast eval", &eval_text);
+	ImGui::InputText("only on server", &server);
+	ImGui::InputText("only in dimension", &dimension);
+	if (ImGui::Button("Send to all") && !pending)
+	{
+		RequestLaneScope interactive{RequestLane::interactive};
+		CommandBuffer eval;
+		eval.eval(eval_text);
+		pending = s.broadcast(
+		    eval,
+		    world.turtle_filter(server, dimension),
+		    std::chrono::seconds{30});
+	}
+	if (pending && pending->is_ready())
+	{
+		replies = pending->get();
+		pending.reset();
+	}
+	if (pending)
+	{
+		ImGui::Text("waiting for the turtles");
+		return;
+	}
+	// an error here is from the controller, a failed eval is in the reply
+	size_t failed = 0;
+	for (auto &reply : replies)
+	{
+		failed += reply.response.is_object() && reply.response.contains("error");
+	}
+	ImGui::Text(
+	    "%zu answered, %zu didn't",
+	    replies.size() - failed,
+	    failed);
+	for (auto &reply : replies)
+	{
+		ImGui::Text(
+		    "%u: %s",
+		    reply.connection_id,
+		    reply.response.dump().c_str());
+	}
+}
+
 void draw_main_ui(
     World &world,
     RenderWorld &render_world,
@@ -123,6 +250,30 @@ void draw_main_ui(
 			ImGui::EndCombo();
 		}
 		ImGui::Checkbox("show all turtles", &show_all_turtles);
+
+		if (ImGui::Checkbox("show block values", &render_world.show_values))
+		{
+			render_world.dirty();
+		}
+		if (render_world.selected_server() && render_world.selected_dimension())
+		{
+			std::pair<const char *, BlockValue::uses> uses[]{
+			    {"farming soil", BlockValue::FarmingSoil},
+			    {"farming storage", BlockValue::FarmingStorage},
+			    {"farming seeds", BlockValue::FarmingSeed}};
+			for (auto &[name, flag] : uses)
+			{
+				ImGui::Text(
+				    "%s: %zu",
+				    name,
+				    world.value_index
+				        .find(
+				            *render_world.selected_server(),
+				            *render_world.selected_dimension(),
+				            flag)
+				        .size());
+			}
+		}
 		ImGui::TreePop();
 	}
 
@@ -162,6 +313,42 @@ void draw_main_ui(
 		ImGui::TreePop();
 	}
 
+	if (ImGui::TreeNode("Broadcast"))
+	{
+		draw_broadcast(world, s);
+		ImGui::TreePop();
+	}
+
+	if (ImGui::TreeNode("Metrics"))
+	{
+		draw_metrics();
+		ImGui::TreePop();
+	}
+
+	if (ImGui::TreeNode("Tracing"))
+	{
+		static std::string trace_filename = "controller.trace.json";
+		bool recording = tracer().active();
+		if (ImGui::Checkbox("record", &recording))
+		{
+			if (recording)
+			{
+				tracer().start();
+			}
+			else
+			{
+				tracer().stop();
+			}
+		}
+		ImGui::InputText("trace file", &trace_filename);
+		// for chrome://tracing or ui.perfetto.dev
+		if (ImGui::Button("Write") && !tracer().write(trace_filename))
+		{
+			std::cout << "can't write the trace to " << trace_filename << '\n';
+		}
+		ImGui::TreePop();
+	}
+
 	static bool demo_toggled = false;
 	ImGui::Checkbox("toggle demo", &demo_toggled);
 	if (demo_toggled)
@@ -213,7 +400,7 @@ void draw_turtle_inventory(Turtle &turtle, World &world)
 		ImGui::Button(button_text.c_str(), {50, 50});
 		auto is_hovered = ImGui::IsItemHovered();
 
-		if (item && turtle.current_inventory_get == std::nullopt
+		if (item && !turtle.inventory_get_underway
 		    && !turtle.connection.expired())
 		{
 			if (ImGui::BeginDragDropSource())
@@ -246,8 +433,7 @@ void draw_turtle_inventory(Turtle &turtle, World &world)
 				ImGui::EndDragDropSource();
 			}
 		}
-		if (turtle.current_inventory_get == std::nullopt
-		    && !turtle.connection.expired())
+		if (!turtle.inventory_get_underway && !turtle.connection.expired())
 		{
 			if (ImGui::BeginDragDropTarget())
 			{
@@ -273,28 +459,31 @@ void draw_turtle_inventory(Turtle &turtle, World &world)
 							break;
 						}
 						auto con = turtle.connection.lock();
-						turtle.current_inventory_get
-						    = con->inventory_move_future(
-						             from + 1,
-						             n + 1,
-						             move_amount)
-						          .then([&turtle,
-						                 &world](boost::future<nlohmann::json>
-						                             result) {
-							          if (!turtle.connection.expired())
-							          {
-								          auto con = turtle.connection.lock();
-								          turtle.last_inventory_get
-								              = std::chrono::steady_clock::now();
-								          return con
-								              ->execute_buffer_future(
-								                  world.inventory_get_buffer)
-								              .get();
-							          }
-							          // connection vanished, unable to get new
-							          // inventory
-							          return turtle.inventory;
-						          });
+						turtle.inventory_get_underway = true;
+						// asks for the new inventory once the move is done
+						world.when_ready(
+						    con->inventory_move_future(
+						        from + 1,
+						        n + 1,
+						        move_amount),
+						    [&world, name = turtle.name](auto) {
+							    auto turtle = world.turtle_named(name);
+							    if (!turtle)
+							    {
+								    return;
+							    }
+							    if (auto con = turtle->connection.lock())
+							    {
+								    world.expect_inventory(
+								        *turtle,
+								        con->execute_buffer_future(
+								            world.inventory_get_buffer));
+							    }
+							    else
+							    {
+								    turtle->inventory_get_underway = false;
+							    }
+						    });
 					}
 				}
 				ImGui::EndDragDropTarget();
@@ -384,9 +573,18 @@ void draw_turtle_value(Turtle &turtle)
 			ImGui::Text("inventory slot: %i", turtle.value.inventory_slot);
 		}
 
+		if (!turtle.value.queued_harvests.empty())
+		{
+			ImGui::Text(
+			    "harvests queued after this: %zu",
+			    turtle.value.queued_harvests.size());
+		}
+
 		if (ImGui::Button("stop action"))
 		{
 			turtle.value.current_action = std::nullopt;
+			turtle.value.queued_harvests.clear();
+			turtle.value.task.reset();
 		}
 	}
 	if (ImGui::TreeNode("force action"))
@@ -495,6 +693,8 @@ void draw_turtle_value(Turtle &turtle)
 				turtle.value.where = where;
 				turtle.value.direction = direction;
 				turtle.value.inventory_slot = slot;
+				turtle.value.queued_harvests.clear();
+				turtle.value.task.reset();
 				switch (*turtle.value.current_action)
 				{
 				case TurtleValue::place_block:
@@ -531,6 +731,8 @@ bool draw_turtle_ui(Turtle &turtle, World &world)
 	    turtle.position.server.c_str());
 	if (!turtle.connection.expired())
 	{
+		// whoever clicked is waiting on it
+		RequestLaneScope interactive{RequestLane::interactive};
 		auto temp = turtle.connection.lock();
 		ImGui::InputTextMultiline("eval input", &eval_text);
 		if (ImGui::Button("Submit Eval"))
@@ -545,19 +747,42 @@ bool draw_turtle_ui(Turtle &turtle, World &world)
 		if (ImGui::TreeNode("Pathing"))
 		{
 			static glm::ivec3 path_target;
+			static PlannerKind planner = PlannerKind::astar;
 			ImGui::InputInt3("path target", glm::value_ptr(path_target));
+			if (ImGui::RadioButton("A*", planner == PlannerKind::astar))
+			{
+				planner = PlannerKind::astar;
+			}
+			ImGui::SameLine();
+			if (ImGui::RadioButton(
+			        "cooperative",
+			        planner == PlannerKind::cooperative))
+			{
+				planner = PlannerKind::cooperative;
+			}
+			ImGui::SameLine();
+			if (ImGui::RadioButton(
+			        "bidirectional",
+			        planner == PlannerKind::bidirectional))
+			{
+				planner = PlannerKind::bidirectional;
+			}
+			ImGui::SameLine();
+			if (ImGui::RadioButton(
+			        "jump point",
+			        planner == PlannerKind::jump_point))
+			{
+				planner = PlannerKind::jump_point;
+			}
 			if (ImGui::Button("Path to target"))
 			{
 				if (turtle.current_pathing)
 				{
-					turtle.current_pathing->finished = true;
-					turtle.current_pathing->pather->stop = true;
-					if (turtle.current_pathing->result.valid())
-					{
-						turtle.current_pathing->result.wait();
-					}
+					// whatever was waiting on it hears it didn't get there
+					turtle.current_pathing->finish(true);
 				}
-				turtle.current_pathing = Pathing{path_target, turtle, world};
+				turtle.replace_pathing(
+				    Pathing{path_target, turtle, world, planner});
 			}
 			if (turtle.current_pathing)
 			{
@@ -578,13 +803,8 @@ bool draw_turtle_ui(Turtle &turtle, World &world)
 				{
 					if (turtle.current_pathing)
 					{
-						turtle.current_pathing->finished = true;
-						turtle.current_pathing->pather->stop = true;
-						if (turtle.current_pathing->result.valid())
-						{
-							turtle.current_pathing->result.wait();
-						}
-						turtle.current_pathing = std::nullopt;
+						turtle.current_pathing->finish(true);
+						turtle.replace_pathing();
 					}
 				}
 			}
@@ -652,6 +872,51 @@ bool draw_turtle_ui(Turtle &turtle, World &world)
 	return !open;
 }
 
+void draw_block_value(Block &block, World &world)
+{
+	static std::optional<glm::ivec3> editing;
+	static BlockValue draft;
+	if (editing != block.position.position)
+	{
+		editing = block.position.position;
+		draft = block.value.value_or(BlockValue{});
+	}
+	std::pair<const char *, BlockValue::uses> uses[]{
+	    {"Farming Soil", BlockValue::FarmingSoil},
+	    {"Farming Storage", BlockValue::FarmingStorage},
+	    {"Farming Seed", BlockValue::FarmingSeed}};
+	for (auto &[name, flag] : uses)
+	{
+		bool set = draft.use & flag;
+		if (ImGui::Checkbox(name, &set))
+		{
+			draft.use = static_cast<BlockValue::uses>(draft.use ^ flag);
+		}
+	}
+	bool farmer = draft.associated_jobs & TurtleValue::FARMER;
+	if (ImGui::Checkbox("checked by farmers", &farmer))
+	{
+		draft.associated_jobs = static_cast<TurtleValue::jobs>(
+		    draft.associated_jobs ^ TurtleValue::FARMER);
+	}
+	double every = draft.check_every.count();
+	if (ImGui::InputDouble("check every (s)", &every))
+	{
+		draft.check_every = std::chrono::duration<double>{every};
+	}
+	ImGui::InputText("to plant", &draft.to_plant);
+	if (ImGui::Button("set value"))
+	{
+		world.set_block_value(block.position, draft);
+	}
+	ImGui::SameLine();
+	if (ImGui::Button("clear value"))
+	{
+		world.set_block_value(block.position, std::nullopt);
+		draft = BlockValue{};
+	}
+}
+
 void draw_selected_ui(
     Block &block,
     World &world,
@@ -668,15 +933,15 @@ void draw_selected_ui(
 	    block.position.position.z);
 	if (ImGui::Button("delete from world"))
 	{
-		erase_nested(
-		    world.m_blocks,
-		    *render_world.selected_server(),
-		    *render_world.selected_dimension(),
-		    block.position.position.x,
-		    block.position.position.y,
-		    block.position.position.z);
+		world.erase_block(block.position);
 		selected = std::monostate{};
 		render_world.dirty();
+		return;
+	}
+	if (ImGui::TreeNode("Value"))
+	{
+		draw_block_value(block, world);
+		ImGui::TreePop();
 	}
 }
 
@@ -704,7 +969,6 @@ bool draw_selected_ui(
 	}
 	if (ImGui::Button("delete from world"))
 	{
-		std::scoped_lock a{world.render_mutex};
 		auto turtle_index = std::get<2>(selected);
 		if (render_world.selected_turtle() == turtle_index)
 		{
@@ -0,0 +1,232 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <map>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <glm/ext.hpp>
+#include <glm/gtx/hash.hpp>
+
+#include "Planner.hpp"
+
+// jump point search on the 6-connected block grid. instead of putting every
+// block of open air on the frontier it runs in straight lines and only stops
+// where something interesting happens: a wall ends beside the line (forced
+// neighbour), the line crosses the goal's plane, or it ran max_jump blocks.
+// the world is unbounded so the last two are what keep open air cheap
+class JumpPointSearch : public Planner
+{
+	public:
+	constexpr static int max_jump = 64;
+	constexpr static int max_side_jump = 8;
+
+	JumpPointSearch(
+	    glm::ivec3 start,
+	    glm::ivec3 end,
+	    std::function<bool(glm::ivec3)> obstacle)
+	    : m_start(start), m_end(end), m_obstacle(obstacle)
+	{
+		if ((m_obstacle(start) || m_obstacle(end)) && !(start == end))
+		{
+			guaranteed_impossible = true;
+		}
+	}
+
+	bool run() override
+	{
+		if (guaranteed_impossible)
+		{
+			return false;
+		}
+		m_g[m_start] = 0;
+		m_open.insert({{heuristic(m_start), 0}, m_start});
+		while (!stop)
+		{
+			if (m_open.empty())
+			{
+				return false;
+			}
+			auto candidate = m_open.begin();
+			auto position = candidate->second;
+			m_open.erase(candidate);
+			if (!m_closed.insert(position).second)
+			{
+				continue;
+			}
+			if (position == m_end)
+			{
+				return true;
+			}
+			expand(position);
+		}
+		return false;
+	}
+
+	bool obstacle(glm::ivec3 pos) override { return m_obstacle(pos); }
+
+	std::vector<glm::ivec3> path_result() override
+	{
+		std::vector<glm::ivec3> jump_points;
+		for (auto pos = m_end; pos != m_start; pos = m_parent.at(pos))
+		{
+			jump_points.push_back(pos);
+		}
+		jump_points.push_back(m_start);
+		std::reverse(jump_points.begin(), jump_points.end());
+
+		std::vector<glm::ivec3> result{m_start};
+		for (size_t i = 1; i < jump_points.size(); i++)
+		{
+			auto step = glm::sign(jump_points[i] - jump_points[i - 1]);
+			for (auto pos = jump_points[i - 1]; pos != jump_points[i];)
+			{
+				pos += step;
+				result.push_back(pos);
+			}
+		}
+		return result;
+	}
+
+	const char *name() const override { return "jump_point"; }
+
+	private:
+	constexpr static std::array<glm::ivec3, 6> directions{
+	    glm::ivec3{-1, 0, 0},
+	    glm::ivec3{1, 0, 0},
+	    glm::ivec3{0, -1, 0},
+	    glm::ivec3{0, 1, 0},
+	    glm::ivec3{0, 0, -1},
+	    glm::ivec3{0, 0, 1}};
+
+	static int axis_of(glm::ivec3 direction)
+	{
+		return direction.x != 0 ? 0 : direction.y != 0 ? 1 : 2;
+	}
+
+	int heuristic(glm::ivec3 position)
+	{
+		auto distance_diff = glm::abs(position - m_end);
+		return distance_diff.x + distance_diff.y + distance_diff.z;
+	}
+
+	void expand(glm::ivec3 position)
+	{
+		expanded_nodes++;
+		int g = m_g.at(position);
+		std::optional<glm::ivec3> arrived;
+		if (auto parent = m_parent.find(position); parent != m_parent.end())
+		{
+			arrived = glm::sign(position - parent->second);
+		}
+		for (auto &direction : directions)
+		{
+			// going back the way we came can't be part of a shortest path
+			if (arrived && direction == -*arrived)
+			{
+				continue;
+			}
+			auto jump_point = jump(position, direction);
+			if (!jump_point || m_closed.contains(*jump_point))
+			{
+				continue;
+			}
+			auto distance_diff = glm::abs(*jump_point - position);
+			int new_g = g + distance_diff.x + distance_diff.y + distance_diff.z;
+			if (auto already = m_g.find(*jump_point);
+			    already != m_g.end() && already->second <= new_g)
+			{
+				continue;
+			}
+			m_g[*jump_point] = new_g;
+			m_parent[*jump_point] = position;
+			m_open.insert(
+			    {{new_g + heuristic(*jump_point), -new_g}, *jump_point});
+		}
+	}
+
+	// lines along y also stop where a line along x would find something, and
+	// lines along z where x or y would, otherwise a shortest path that turns
+	// partway down a line is never seen. those side lines only count the goal
+	// and forced neighbours, counting plane crossings would stop every step.
+	// they only look max_side_jump blocks out, looking all the way sweeps
+	// whole slabs of open air, turns further out than that can come out a
+	// little longer than the A* path
+	std::optional<glm::ivec3>
+	jump(glm::ivec3 from, glm::ivec3 direction, bool side_line = false)
+	{
+		int axis = axis_of(direction);
+		int reach = side_line ? max_side_jump : max_jump;
+		auto position = from;
+		for (int distance = 1; distance <= reach; distance++)
+		{
+			auto previous = position;
+			position += direction;
+			if (m_obstacle(position))
+			{
+				// stopping in front of the wall gives the search something
+				// to run along the face from
+				if (side_line || distance == 1)
+				{
+					return std::nullopt;
+				}
+				return previous;
+			}
+			if (position == m_end)
+			{
+				return position;
+			}
+			if (!side_line
+			    && (position[axis] == m_end[axis] || distance == max_jump))
+			{
+				return position;
+			}
+			for (auto &side : directions)
+			{
+				if (axis_of(side) == axis)
+				{
+					continue;
+				}
+				if (!m_obstacle(position + side) && m_obstacle(previous + side))
+				{
+					return position;
+				}
+			}
+			for (size_t side = 0; side < directions.size(); side++)
+			{
+				if (axis_of(directions[side]) < axis && side_jump(position, side))
+				{
+					return position;
+				}
+			}
+		}
+		return std::nullopt;
+	}
+
+	// the same side lines get walked from many cells of open air
+	bool side_jump(glm::ivec3 from, size_t direction)
+	{
+		auto &known = m_side_lines[direction];
+		if (auto found = known.find(from); found != known.end())
+		{
+			return found->second;
+		}
+		bool result = jump(from, directions[direction], true).has_value();
+		known[from] = result;
+		return result;
+	}
+
+	bool guaranteed_impossible = false;
+	glm::ivec3 m_start;
+	glm::ivec3 m_end;
+	std::function<bool(glm::ivec3)> m_obstacle;
+
+	std::multimap<std::pair<int, int>, glm::ivec3> m_open;
+	std::unordered_map<glm::ivec3, int> m_g;
+	std::unordered_map<glm::ivec3, glm::ivec3> m_parent;
+	std::unordered_set<glm::ivec3> m_closed;
+	std::array<std::unordered_map<glm::ivec3, bool>, 6> m_side_lines;
+};
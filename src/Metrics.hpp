@@ -0,0 +1,410 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// what the controller counts about itself: request queues and reply times,
+// traffic, how long searches and saves take. everything is registered by name
+// in one registry which the server serves as prometheus text and the gui
+// draws. metrics are updated from whatever thread does the work
+
+using MetricLabels = std::vector<std::pair<std::string, std::string>>;
+
+class Counter
+{
+	public:
+	void add(uint64_t amount = 1)
+	{
+		m_value.fetch_add(amount, std::memory_order_relaxed);
+	}
+	uint64_t value() const { return m_value.load(std::memory_order_relaxed); }
+
+	private:
+	std::atomic<uint64_t> m_value = 0;
+};
+
+class Gauge
+{
+	public:
+	void set(double value) { m_value.store(value, std::memory_order_relaxed); }
+	void add(double amount)
+	{
+		m_value.fetch_add(amount, std::memory_order_relaxed);
+	}
+	double value() const { return m_value.load(std::memory_order_relaxed); }
+
+	private:
+	std::atomic<double> m_value = 0;
+};
+
+class Histogram
+{
+	public:
+	// upper bounds of the buckets, seconds from a millisecond to ten
+	static inline const std::vector<double> default_bounds{
+	    0.001,
+	    0.0025,
+	    0.005,
+	    0.01,
+	    0.025,
+	    0.05,
+	    0.1,
+	    0.25,
+	    0.5,
+	    1,
+	    2.5,
+	    5,
+	    10};
+
+	explicit Histogram(std::vector<double> bounds = default_bounds)
+	    : m_bounds(std::move(bounds)), m_buckets(m_bounds.size() + 1)
+	{
+	}
+
+	void observe(double value)
+	{
+		auto bucket = std::lower_bound(m_bounds.begin(), m_bounds.end(), value)
+		              - m_bounds.begin();
+		m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+		m_sum.fetch_add(value, std::memory_order_relaxed);
+	}
+
+	const std::vector<double> &bounds() const { return m_bounds; }
+	// not cumulative, the last one holds everything above the last bound
+	std::vector<uint64_t> buckets() const
+	{
+		std::vector<uint64_t> counts;
+		counts.reserve(m_buckets.size());
+		for (auto &bucket : m_buckets)
+		{
+			counts.push_back(bucket.load(std::memory_order_relaxed));
+		}
+		return counts;
+	}
+	double sum() const { return m_sum.load(std::memory_order_relaxed); }
+
+	private:
+	std::vector<double> m_bounds;
+	std::vector<std::atomic<uint64_t>> m_buckets;
+	std::atomic<double> m_sum = 0;
+};
+
+class Metrics
+{
+	public:
+	enum kinds
+	{
+		counter_kind,
+		gauge_kind,
+		histogram_kind
+	};
+
+	// one labelled metric as it was when read
+	struct Series
+	{
+		MetricLabels labels;
+		// counters and gauges
+		double value = 0;
+		// histograms, not cumulative
+		std::vector<uint64_t> buckets;
+		double sum = 0;
+		uint64_t count = 0;
+
+		// estimated from the buckets, the bound of the last bucket if it
+		// lands above the last bound
+		double quantile(const std::vector<double> &bounds, double q) const
+		{
+			if (count == 0)
+			{
+				return 0;
+			}
+			double rank = q * count;
+			double seen = 0;
+			for (size_t i = 0; i < buckets.size(); i++)
+			{
+				if (seen + buckets[i] >= rank && buckets[i] != 0)
+				{
+					if (i == bounds.size())
+					{
+						return bounds.empty() ? 0 : bounds.back();
+					}
+					double lower = i == 0 ? 0 : bounds[i - 1];
+					return lower
+					       + (bounds[i] - lower) * (rank - seen) / buckets[i];
+				}
+				seen += buckets[i];
+			}
+			return bounds.empty() ? 0 : bounds.back();
+		}
+	};
+
+	struct Family
+	{
+		std::string name;
+		std::string help;
+		kinds kind;
+		std::vector<double> bounds;
+		std::vector<Series> series;
+	};
+
+	// the same name and labels always give back the same metric, which lives
+	// as long as the registry unless its family is cleared
+	Counter &counter(
+	    const std::string &name,
+	    const std::string &help,
+	    const MetricLabels &labels = {})
+	{
+		std::scoped_lock a{m_mutex};
+		auto &family = family_for(name, help, counter_kind, {});
+		auto &counter = family.counters[labels];
+		if (!counter)
+		{
+			counter = std::make_unique<Counter>();
+		}
+		return *counter;
+	}
+	Gauge &gauge(
+	    const std::string &name,
+	    const std::string &help,
+	    const MetricLabels &labels = {})
+	{
+		std::scoped_lock a{m_mutex};
+		auto &family = family_for(name, help, gauge_kind, {});
+		auto &gauge = family.gauges[labels];
+		if (!gauge)
+		{
+			gauge = std::make_unique<Gauge>();
+		}
+		return *gauge;
+	}
+	Histogram &histogram(
+	    const std::string &name,
+	    const std::string &help,
+	    const MetricLabels &labels = {},
+	    const std::vector<double> &bounds = Histogram::default_bounds)
+	{
+		std::scoped_lock a{m_mutex};
+		auto &family = family_for(name, help, histogram_kind, bounds);
+		auto &histogram = family.histograms[labels];
+		if (!histogram)
+		{
+			histogram = std::make_unique<Histogram>(family.bounds);
+		}
+		return *histogram;
+	}
+
+	// drops every metric of a family, for gauges a collector sets from
+	// scratch each time. anything still holding one of them must not use it
+	void clear(const std::string &name)
+	{
+		std::scoped_lock a{m_mutex};
+		if (auto found = m_families.find(name); found != m_families.end())
+		{
+			found->second.counters.clear();
+			found->second.gauges.clear();
+			found->second.histograms.clear();
+		}
+	}
+
+	// collectors run before the metrics are read, to set gauges that are
+	// easier to look up than to keep up to date. the id removes it again
+	size_t add_collector(std::function<void(Metrics &)> collector)
+	{
+		std::scoped_lock a{m_collectors_mutex};
+		auto id = m_next_collector++;
+		m_collectors.emplace(id, std::move(collector));
+		return id;
+	}
+	void remove_collector(size_t id)
+	{
+		std::scoped_lock a{m_collectors_mutex};
+		m_collectors.erase(id);
+	}
+
+	std::vector<Family> read()
+	{
+		// held until the copy is made, so two reads don't see each other's
+		// collectors half done
+		std::scoped_lock collecting{m_collectors_mutex};
+		for (auto &collector : m_collectors)
+		{
+			collector.second(*this);
+		}
+		std::scoped_lock a{m_mutex};
+		std::vector<Family> families;
+		for (auto &[name, stored] : m_families)
+		{
+			auto &family = families.emplace_back();
+			family.name = name;
+			family.help = stored.help;
+			family.kind = stored.kind;
+			family.bounds = stored.bounds;
+			for (auto &[labels, counter] : stored.counters)
+			{
+				auto &series = family.series.emplace_back();
+				series.labels = labels;
+				series.value = counter->value();
+			}
+			for (auto &[labels, gauge] : stored.gauges)
+			{
+				auto &series = family.series.emplace_back();
+				series.labels = labels;
+				series.value = gauge->value();
+			}
+			for (auto &[labels, histogram] : stored.histograms)
+			{
+				auto &series = family.series.emplace_back();
+				series.labels = labels;
+				series.buckets = histogram->buckets();
+				series.sum = histogram->sum();
+				for (auto count : series.buckets)
+				{
+					series.count += count;
+				}
+			}
+		}
+		return families;
+	}
+
+	// the prometheus text format
+	std::string prometheus()
+	{
+		std::ostringstream text;
+		text << std::setprecision(15);
+		for (auto &family : read())
+		{
+			static const char *type_names[]{"counter", "gauge", "histogram"};
+			text << "# HELP " << family.name << ' ' << family.help << '\n'
+			     << "# TYPE " << family.name << ' ' << type_names[family.kind]
+			     << '\n';
+			for (auto &series : family.series)
+			{
+				if (family.kind != histogram_kind)
+				{
+					text << family.name << format_labels(series.labels) << ' '
+					     << series.value << '\n';
+					continue;
+				}
+				uint64_t cumulative = 0;
+				for (size_t i = 0; i < series.buckets.size(); i++)
+				{
+					cumulative += series.buckets[i];
+					std::ostringstream bound;
+					bound << std::setprecision(15);
+					if (i < family.bounds.size())
+					{
+						bound << family.bounds[i];
+					}
+					else
+					{
+						bound << "+Inf";
+					}
+					auto labels = series.labels;
+					labels.emplace_back("le", bound.str());
+					text << family.name << "_bucket" << format_labels(labels)
+					     << ' ' << cumulative << '\n';
+				}
+				text << family.name << "_sum" << format_labels(series.labels)
+				     << ' ' << series.sum << '\n'
+				     << family.name << "_count"
+				     << format_labels(series.labels) << ' ' << series.count
+				     << '\n';
+			}
+		}
+		return text.str();
+	}
+
+	// {name="value",...}, or nothing without labels
+	static std::string format_labels(const MetricLabels &labels)
+	{
+		if (labels.empty())
+		{
+			return {};
+		}
+		std::string text = "{";
+		for (auto &[name, value] : labels)
+		{
+			if (text.size() > 1)
+			{
+				text += ',';
+			}
+			text += name + "=\"";
+			for (char c : value)
+			{
+				switch (c)
+				{
+				case '\\':
+					text += "\\\\";
+					break;
+				case '"':
+					text += "\\\"";
+					break;
+				case '\n':
+					text += "\\n";
+					break;
+				default:
+					text += c;
+				}
+			}
+			text += '"';
+		}
+		return text + '}';
+	}
+
+	private:
+	struct StoredFamily
+	{
+		std::string help;
+		kinds kind;
+		std::vector<double> bounds;
+		std::map<MetricLabels, std::unique_ptr<Counter>> counters;
+		std::map<MetricLabels, std::unique_ptr<Gauge>> gauges;
+		std::map<MetricLabels, std::unique_ptr<Histogram>> histograms;
+	};
+
+	StoredFamily &family_for(
+	    const std::string &name,
+	    const std::string &help,
+	    kinds kind,
+	    const std::vector<double> &bounds)
+	{
+		auto [family, inserted] = m_families.try_emplace(name);
+		if (inserted)
+		{
+			family->second.help = help;
+			family->second.kind = kind;
+			family->second.bounds = bounds;
+		}
+		else if (family->second.kind != kind)
+		{
+			throw std::logic_error{
+			    "metric " + name + " registered as two different kinds"};
+		}
+		return family->second;
+	}
+
+	std::mutex m_mutex;
+	std::map<std::string, StoredFamily> m_families;
+
+	std::mutex m_collectors_mutex;
+	std::map<size_t, std::function<void(Metrics &)>> m_collectors;
+	size_t m_next_collector = 0;
+};
+
+// the registry everything reports to
+inline Metrics &metrics()
+{
+	static Metrics registry;
+	return registry;
+}
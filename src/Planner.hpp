@@ -0,0 +1,39 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+#include <glm/ext.hpp>
+
+enum class PlannerKind
+{
+	astar,
+	cooperative,
+	bidirectional,
+	jump_point
+};
+
+enum class ObstacleKind
+{
+	normal,
+	allow_mining
+};
+
+class Planner
+{
+	public:
+	virtual ~Planner() = default;
+
+	virtual bool run() = 0;
+	virtual bool obstacle(glm::ivec3 pos) = 0;
+	virtual std::vector<glm::ivec3> path_result() = 0;
+	// what the planner is called in metrics
+	virtual const char *name() const = 0;
+	// the result stops short of the goal on purpose, the rest is planned
+	// from wherever it ends
+	virtual bool partial() const { return false; }
+
+	std::atomic<bool> stop = false;
+	// nodes taken off the open list by run, only read once it's done
+	size_t expanded_nodes = 0;
+};
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glm/ext.hpp>
+
+#include "world.hpp"
+
+// which part of the world the renderer shows, set from the gui thread
+struct RenderView
+{
+	std::optional<std::string> server;
+	std::optional<std::string> dimension;
+	bool show_values = false;
+};
+
+// a copy of what the renderer draws from the world, so drawing a frame
+// doesn't have to hold the world
+struct RenderScene
+{
+	RenderView view;
+	std::vector<glm::ivec4> block_positions;
+	std::vector<glm::vec4> block_colors;
+	// every turtle, by its index in World::m_turtles
+	std::vector<WorldLocation> turtles;
+	// the turtles in view, as instances
+	std::vector<glm::ivec4> turtle_positions;
+	std::vector<glm::vec4> turtle_colors;
+	// blocks with a value and the color of what they are used for
+	std::vector<std::pair<glm::ivec3, glm::dvec4>> value_blocks;
+};
+
+using RenderPaths = std::vector<std::vector<glm::ivec3>>;
+
+// the latest scene and paths. the automation engine publishes them at the
+// end of each tick and only copies what was marked dirty since the last
+// time, the gui thread wakes it up when its panels marked something. the
+// renderer picks up the newest copy whenever it draws
+class RenderSnapshots
+{
+	public:
+	// can be called from any thread
+	void dirty() { m_dirty = true; }
+	void dirty_paths() { m_paths_dirty = true; }
+	// something was marked that the next publish copies
+	bool pending() const { return m_dirty || m_paths_dirty; }
+
+	void set_view(RenderView view)
+	{
+		std::scoped_lock a{m_mutex};
+		m_view = std::move(view);
+		m_dirty = true;
+	}
+	RenderView view()
+	{
+		std::scoped_lock a{m_mutex};
+		return m_view;
+	}
+
+	// the caller holds the world
+	void publish(World &world)
+	{
+		if (m_dirty.exchange(false))
+		{
+			auto scene = std::make_shared<RenderScene>();
+			scene->view = view();
+			fill_scene(world, *scene);
+			std::scoped_lock a{m_mutex};
+			m_scene = std::move(scene);
+		}
+		if (m_paths_dirty.exchange(false))
+		{
+			auto paths = std::make_shared<RenderPaths>();
+			for (auto &turtle : world.m_turtles)
+			{
+				if (turtle.current_pathing
+				    && turtle.current_pathing->latest_results.size() >= 2)
+				{
+					paths->push_back(turtle.current_pathing->latest_results);
+				}
+			}
+			std::scoped_lock a{m_mutex};
+			m_paths = std::move(paths);
+		}
+	}
+
+	std::shared_ptr<const RenderScene> scene()
+	{
+		std::scoped_lock a{m_mutex};
+		return m_scene;
+	}
+	std::shared_ptr<const RenderPaths> paths()
+	{
+		std::scoped_lock a{m_mutex};
+		return m_paths;
+	}
+
+	private:
+	static void fill_scene(World &world, RenderScene &scene)
+	{
+		auto &view = scene.view;
+		auto server = view.server ? world.m_blocks.find(*view.server)
+		                          : world.m_blocks.end();
+		if (server != world.m_blocks.end() && view.dimension)
+		{
+			auto dimension = server->second.find(*view.dimension);
+			if (dimension != server->second.end())
+			{
+				for (auto &x : dimension->second)
+				{
+					for (auto &y : x.second)
+					{
+						for (auto &z : y.second)
+						{
+							scene.block_positions
+							    .emplace_back(x.first, y.first, z.first, 0);
+							scene.block_colors.emplace_back(z.second.color, 1);
+						}
+					}
+				}
+			}
+		}
+
+		scene.turtles.reserve(world.m_turtles.size());
+		for (auto &turtle : world.m_turtles)
+		{
+			scene.turtles.push_back(turtle.position);
+			if (view.server && *view.server == turtle.position.server
+			    && view.dimension
+			    && *view.dimension == turtle.position.dimension)
+			{
+				scene.turtle_positions.emplace_back(
+				    turtle.position.position,
+				    turtle.position.direction);
+				scene.turtle_colors.emplace_back(1, 1, 1, 1);
+			}
+		}
+
+		if (view.show_values && view.server && view.dimension)
+		{
+			std::pair<BlockValue::uses, glm::dvec4> uses[]{
+			    {BlockValue::FarmingSoil, {0.6, 0.4, 0.2, 1}},
+			    {BlockValue::FarmingStorage, {0.2, 0.4, 1, 1}},
+			    {BlockValue::FarmingSeed, {0.2, 1, 0.2, 1}}};
+			for (auto &[flag, color] : uses)
+			{
+				for (auto &position : world.value_index.find(
+				         *view.server,
+				         *view.dimension,
+				         flag))
+				{
+					scene.value_blocks.emplace_back(position, color);
+				}
+			}
+		}
+	}
+
+	std::mutex m_mutex;
+	RenderView m_view;
+	std::atomic<bool> m_dirty = true;
+	std::atomic<bool> m_paths_dirty = true;
+	std::shared_ptr<const RenderScene> m_scene
+	    = std::make_shared<RenderScene>();
+	std::shared_ptr<const RenderPaths> m_paths
+	    = std::make_shared<RenderPaths>();
+};
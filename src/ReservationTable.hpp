@@ -0,0 +1,282 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/ext.hpp>
+#include <glm/gtx/hash.hpp>
+
+struct SpaceTime
+{
+	glm::ivec3 position;
+	int time;
+
+	bool operator==(const SpaceTime &other) const
+	{
+		return position == other.position && time == other.time;
+	}
+};
+
+template <>
+struct std::hash<SpaceTime>
+{
+	std::size_t operator()(const SpaceTime &st) const
+	{
+		return std::hash<glm::ivec3>{}(st.position)
+		       ^ (std::hash<int>{}(st.time) * 0x9e3779b97f4a7c15);
+	}
+};
+
+// who is standing where at which step, used by cooperative pathing so turtles
+// plan around each other instead of discovering each other mid path.
+// time is counted in movement steps since the table was created
+class ReservationTable
+{
+	public:
+	constexpr static std::chrono::duration<double> step_duration{0.5};
+
+	ReservationTable() : m_epoch(std::chrono::steady_clock::now()) {}
+
+	int now()
+	{
+		std::scoped_lock a{m_mutex};
+		return m_now;
+	}
+
+	void advance(std::chrono::steady_clock::time_point time)
+	{
+		std::scoped_lock a{m_mutex};
+		int step = static_cast<int>((time - m_epoch) / step_duration);
+		if (step <= m_now)
+		{
+			return;
+		}
+		m_now = step;
+		for (auto &owned : m_owned)
+		{
+			std::erase_if(owned.second, [this](const SpaceTime &st) {
+				if (st.time < m_now)
+				{
+					m_reservations.erase(st);
+					return true;
+				}
+				return false;
+			});
+		}
+	}
+
+	bool is_free(glm::ivec3 position, int time, const std::string &owner)
+	{
+		std::scoped_lock a{m_mutex};
+		return is_free_impl(position, time, owner);
+	}
+	bool can_move(
+	    glm::ivec3 from,
+	    glm::ivec3 to,
+	    int time,
+	    const std::string &owner)
+	{
+		std::scoped_lock a{m_mutex};
+		return can_move_impl(from, to, time, owner);
+	}
+	bool is_resting_elsewhere(glm::ivec3 position, const std::string &owner)
+	{
+		std::scoped_lock a{m_mutex};
+		auto resting = m_resting.find(position);
+		return resting != m_resting.end() && resting->second.first != owner
+		       && resting->second.second <= m_now;
+	}
+	bool can_rest(glm::ivec3 position, int from, const std::string &owner)
+	{
+		std::scoped_lock a{m_mutex};
+		return can_rest_impl(position, from, owner);
+	}
+	std::optional<std::string> owner_at(glm::ivec3 position, int time)
+	{
+		std::scoped_lock a{m_mutex};
+		return owner_at_impl(position, time);
+	}
+
+	// reserves path[i] at start_time + i and parks the owner on the last
+	// position afterwards, fails without touching the table if any of it
+	// collides with someone else
+	bool try_reserve(
+	    const std::string &owner,
+	    const std::vector<glm::ivec3> &path,
+	    int start_time)
+	{
+		std::scoped_lock a{m_mutex};
+		if (path.empty())
+		{
+			return false;
+		}
+		for (size_t i = 0; i + 1 < path.size(); i++)
+		{
+			if (!can_move_impl(path[i], path[i + 1], start_time + i, owner))
+			{
+				return false;
+			}
+		}
+		int arrival = start_time + static_cast<int>(path.size()) - 1;
+		if (!can_rest_impl(path.back(), arrival, owner))
+		{
+			return false;
+		}
+		release_impl(owner);
+		auto &owned = m_owned[owner];
+		for (size_t i = 0; i < path.size(); i++)
+		{
+			SpaceTime st{path[i], start_time + static_cast<int>(i)};
+			m_reservations[st] = owner;
+			owned.push_back(st);
+		}
+		m_latest = std::max(m_latest, arrival);
+		rest_impl(owner, path.back(), arrival);
+		return true;
+	}
+
+	// parks the owner on position from the given step onwards, replacing any
+	// previous parking spot
+	void rest(const std::string &owner, glm::ivec3 position, int from)
+	{
+		std::scoped_lock a{m_mutex};
+		rest_impl(owner, position, from);
+	}
+
+	// parks the owner from now on and drops whatever path it had reserved
+	void park(const std::string &owner, glm::ivec3 position)
+	{
+		std::scoped_lock a{m_mutex};
+		auto previous = m_rest_of.find(owner);
+		auto owned = m_owned.find(owner);
+		if (previous != m_rest_of.end() && previous->second == position
+		    && (owned == m_owned.end() || owned->second.empty()))
+		{
+			return;
+		}
+		release_impl(owner);
+		rest_impl(owner, position, m_now);
+	}
+
+	void release(const std::string &owner)
+	{
+		std::scoped_lock a{m_mutex};
+		release_impl(owner);
+	}
+
+	private:
+	bool is_free_impl(glm::ivec3 position, int time, const std::string &owner)
+	{
+		if (auto reserved = m_reservations.find({position, time});
+		    reserved != m_reservations.end() && reserved->second != owner)
+		{
+			return false;
+		}
+		if (auto resting = m_resting.find(position);
+		    resting != m_resting.end() && resting->second.first != owner
+		    && resting->second.second <= time)
+		{
+			return false;
+		}
+		return true;
+	}
+	bool can_move_impl(
+	    glm::ivec3 from,
+	    glm::ivec3 to,
+	    int time,
+	    const std::string &owner)
+	{
+		if (!is_free_impl(to, time + 1, owner))
+		{
+			return false;
+		}
+		if (from == to)
+		{
+			return true;
+		}
+		// two turtles swapping places would pass through each other
+		auto there_now = owner_at_impl(to, time);
+		if (there_now && *there_now != owner)
+		{
+			auto here_next = owner_at_impl(from, time + 1);
+			if (here_next && *here_next == *there_now)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+	bool can_rest_impl(glm::ivec3 position, int from, const std::string &owner)
+	{
+		for (int t = from; t <= std::max(from, m_latest); t++)
+		{
+			if (!is_free_impl(position, t, owner))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+	std::optional<std::string> owner_at_impl(glm::ivec3 position, int time)
+	{
+		if (auto reserved = m_reservations.find({position, time});
+		    reserved != m_reservations.end())
+		{
+			return reserved->second;
+		}
+		if (auto resting = m_resting.find(position);
+		    resting != m_resting.end() && resting->second.second <= time)
+		{
+			return resting->second.first;
+		}
+		return std::nullopt;
+	}
+	void rest_impl(const std::string &owner, glm::ivec3 position, int from)
+	{
+		if (auto previous = m_rest_of.find(owner); previous != m_rest_of.end())
+		{
+			if (previous->second == position)
+			{
+				auto &resting = m_resting.at(position);
+				resting.second = std::min(resting.second, from);
+				return;
+			}
+			m_resting.erase(previous->second);
+		}
+		if (auto taken = m_resting.find(position); taken != m_resting.end())
+		{
+			m_rest_of.erase(taken->second.first);
+		}
+		m_resting[position] = {owner, from};
+		m_rest_of[owner] = position;
+	}
+	void release_impl(const std::string &owner)
+	{
+		if (auto owned = m_owned.find(owner); owned != m_owned.end())
+		{
+			for (auto &st : owned->second)
+			{
+				m_reservations.erase(st);
+			}
+			m_owned.erase(owned);
+		}
+		if (auto previous = m_rest_of.find(owner); previous != m_rest_of.end())
+		{
+			m_resting.erase(previous->second);
+			m_rest_of.erase(previous);
+		}
+	}
+
+	std::mutex m_mutex;
+	std::chrono::steady_clock::time_point m_epoch;
+	int m_now = 0;
+	int m_latest = 0;
+	std::unordered_map<SpaceTime, std::string> m_reservations;
+	std::unordered_map<std::string, std::vector<SpaceTime>> m_owned;
+	std::unordered_map<glm::ivec3, std::pair<std::string, int>> m_resting;
+	std::unordered_map<std::string, glm::ivec3> m_rest_of;
+};
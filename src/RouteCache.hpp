@@ -0,0 +1,173 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <glm/ext.hpp>
+#include <glm/gtx/hash.hpp>
+
+#include "Planner.hpp"
+
+constexpr int chunk_shift = 4; // 16 block chunks
+
+inline glm::ivec3 chunk_of(glm::ivec3 position)
+{
+	return glm::ivec3{
+	    position.x >> chunk_shift,
+	    position.y >> chunk_shift,
+	    position.z >> chunk_shift};
+}
+
+struct RouteKey
+{
+	std::string server;
+	std::string dimension;
+	glm::ivec3 start;
+	glm::ivec3 goal;
+	ObstacleKind obstacles;
+
+	bool operator==(const RouteKey &other) const = default;
+};
+
+template <>
+struct std::hash<RouteKey>
+{
+	std::size_t operator()(const RouteKey &key) const
+	{
+		std::hash<glm::ivec3> vec_hash;
+		std::hash<std::string> string_hash;
+		auto hash = string_hash(key.server);
+		hash = hash * 31 + string_hash(key.dimension);
+		hash = hash * 31 + vec_hash(key.start);
+		hash = hash * 31 + vec_hash(key.goal);
+		return hash * 31 + static_cast<std::size_t>(key.obstacles);
+	}
+};
+
+// remembers finished paths so repeated trips between the same blocks are a
+// lookup, an entry is only handed out while none of the chunks it runs
+// through (or stands on) have changed since it was stored
+class RouteCache
+{
+	public:
+	using version_lookup = std::function<uint64_t(glm::ivec3 chunk)>;
+
+	constexpr static size_t capacity = 4096;
+
+	std::optional<std::vector<glm::ivec3>>
+	find(const RouteKey &key, const version_lookup &version_of)
+	{
+		std::scoped_lock a{m_mutex};
+		auto entry = m_entries.find(key);
+		if (entry == m_entries.end())
+		{
+			misses++;
+			return std::nullopt;
+		}
+		for (auto &[chunk, version] : entry->second.chunks)
+		{
+			if (version_of(chunk) != version)
+			{
+				m_entries.erase(entry);
+				invalidations++;
+				misses++;
+				return std::nullopt;
+			}
+		}
+		entry->second.last_used = ++m_clock;
+		hits++;
+		return entry->second.path;
+	}
+
+	void store(
+	    const RouteKey &key,
+	    std::vector<glm::ivec3> path,
+	    const version_lookup &version_of)
+	{
+		std::unordered_set<glm::ivec3> chunks;
+		for (auto &position : path)
+		{
+			chunks.insert(chunk_of(position));
+			// obstacle functions look at the block below as well
+			chunks.insert(chunk_of(position + glm::ivec3{0, -1, 0}));
+		}
+		Entry entry;
+		entry.path = std::move(path);
+		for (auto &chunk : chunks)
+		{
+			entry.chunks.emplace_back(chunk, version_of(chunk));
+		}
+		std::scoped_lock a{m_mutex};
+		if (m_entries.size() >= capacity && !m_entries.contains(key))
+		{
+			evict();
+		}
+		entry.last_used = ++m_clock;
+		m_entries[key] = std::move(entry);
+	}
+
+	void clear()
+	{
+		std::scoped_lock a{m_mutex};
+		m_entries.clear();
+	}
+
+	size_t hits = 0, misses = 0, invalidations = 0;
+
+	private:
+	struct Entry
+	{
+		std::vector<glm::ivec3> path;
+		std::vector<std::pair<glm::ivec3, uint64_t>> chunks;
+		uint64_t last_used = 0;
+	};
+
+	// drops the least recently used quarter of the cache
+	void evict()
+	{
+		std::vector<uint64_t> ages;
+		ages.reserve(m_entries.size());
+		for (auto &entry : m_entries)
+		{
+			ages.push_back(entry.second.last_used);
+		}
+		auto cutoff = ages.begin() + ages.size() / 4;
+		std::nth_element(ages.begin(), cutoff, ages.end());
+		std::erase_if(m_entries, [threshold = *cutoff](auto &entry) {
+			return entry.second.last_used <= threshold;
+		});
+	}
+
+	std::mutex m_mutex;
+	uint64_t m_clock = 0;
+	std::unordered_map<RouteKey, Entry> m_entries;
+};
+
+// hands out a cached path, still checks obstacles through the real obstacle
+// function so the turtle repaths if something moved into the way
+class CachedRoute : public Planner
+{
+	public:
+	CachedRoute(
+	    std::vector<glm::ivec3> path,
+	    std::function<bool(glm::ivec3)> obstacle)
+	    : m_path(std::move(path)), m_obstacle(obstacle)
+	{
+	}
+
+	bool run() override { return !m_path.empty(); }
+	bool obstacle(glm::ivec3 pos) override { return m_obstacle(pos); }
+	std::vector<glm::ivec3> path_result() override { return m_path; }
+	const char *name() const override { return "cached"; }
+
+	private:
+	std::vector<glm::ivec3> m_path;
+	std::function<bool(glm::ivec3)> m_obstacle;
+};
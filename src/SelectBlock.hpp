@@ -4,8 +4,10 @@
 
 #include <glm/ext.hpp>
 
-#include "render_world.hpp"
+#include "RenderSnapshot.hpp"
 
+// picking only needs the scene, the renderer is a template parameter so this
+// can be used without a window
 class RayInfo
 {
 	public:
@@ -16,22 +18,30 @@ class RayInfo
 
 	constexpr static inline glm::dvec3 box_size = {0.5, 0.5, 0.5};
 
-	RayInfo(glm::dvec2 normalized_mouse, RenderWorld &Camera)
+	template <typename Renderer>
+	RayInfo(glm::dvec2 normalized_mouse, Renderer &Camera)
+	    : RayInfo(
+	        Camera.camera.GetPosition(),
+	        glm::unProject(
+	            glm::dvec3{normalized_mouse, 1},
+	            Camera.camera.GetView(),
+	            Camera.camera.GetProjection(),
+	            glm::vec4{-1, -1, 2, 2})
+	            - Camera.camera.GetPosition())
 	{
-		ray_origin = Camera.camera.GetPosition();
-		ray_direction = glm::unProject(
-		    glm::dvec3{normalized_mouse, 1},
-		    Camera.camera.GetView(),
-		    Camera.camera.GetProjection(),
-		    glm::vec4{-1, -1, 2, 2}) - ray_origin;
-		ray_direction = glm::normalize(ray_direction);
+	}
+
+	RayInfo(glm::dvec3 origin, glm::dvec3 direction)
+	{
+		ray_origin = origin;
+		ray_direction = glm::normalize(direction);
 
 		m = 1.0 / ray_direction;
 		k = glm::abs(m) * box_size;
 	}
 };
 
-glm::vec2 box_intersection(RayInfo &info, glm::dvec3 box_position)
+inline glm::vec2 box_intersection(RayInfo &info, glm::dvec3 box_position)
 {
 	auto ro = info.ray_origin - box_position;
 	glm::dvec3 n
@@ -45,11 +55,9 @@ glm::vec2 box_intersection(RayInfo &info, glm::dvec3 box_position)
 	return glm::vec2(tN, tF);
 }
 
-std::variant<std::monostate, glm::ivec3, size_t> find_selected(
-    RayInfo ray,
-    World &world,
-    std::string server,
-    std::string dimension)
+// what the ray hits first in the scene the renderer last drew
+inline std::variant<std::monostate, glm::ivec3, size_t>
+find_selected(RayInfo ray, const RenderScene &scene)
 {
 	auto make_valid_function
 	    = [](double ro, double rd) -> std::function<bool(int)> {
@@ -83,49 +91,32 @@ std::variant<std::monostate, glm::ivec3, size_t> find_selected(
 	double current_min_distance = std::numeric_limits<double>::max();
 	std::variant<std::monostate, glm::ivec3, size_t> current_selected{
 	    std::monostate{}};
-	for (auto &x : world.m_blocks[server][dimension])
+	for (auto &block : scene.block_positions)
 	{
-		if (!x_valid(x.first))
+		if (!x_valid(block.x) || !y_valid(block.y) || !z_valid(block.z))
 		{
 			continue;
 		}
-		for (auto &y : x.second)
+		auto distances = box_intersection(
+		    ray,
+		    glm::dvec3{glm::ivec3{block}} + glm::dvec3{0.5, 0.5, 0.5});
+		if (distances[0] != -1 && distances[0] < current_min_distance)
 		{
-			if (!y_valid(y.first))
-			{
-				continue;
-			}
-			for (auto &z : y.second)
-			{
-				if (!z_valid(z.first))
-				{
-					continue;
-				}
-				auto distances = box_intersection(
-				    ray,
-				    glm::dvec3{z.second.position.position}
-				        + glm::dvec3{0.5, 0.5, 0.5});
-				if (distances[0] != -1 && distances[0] < current_min_distance)
-				{
-					current_min_distance = distances[0];
-					current_selected = glm::ivec3{x.first, y.first, z.first};
-				}
-			}
+			current_min_distance = distances[0];
+			current_selected = glm::ivec3{block};
 		}
 	}
-	for (size_t i = 0; i < world.m_turtles.size(); i++)
+	for (size_t i = 0; i < scene.turtles.size(); i++)
 	{
-		auto &turtle = world.m_turtles[i];
-		if (turtle.position.server == server
-		    && turtle.position.dimension == dimension
-		    && (turtle.position.position.x)
-		    && y_valid(turtle.position.position.y)
-		    && z_valid(turtle.position.position.z))
+		auto &turtle = scene.turtles[i];
+		if (turtle.server == scene.view.server
+		    && turtle.dimension == scene.view.dimension
+		    && x_valid(turtle.position.x) && y_valid(turtle.position.y)
+		    && z_valid(turtle.position.z))
 		{
 			auto distances = box_intersection(
 			    ray,
-			    glm::dvec3{turtle.position.position}
-			        + glm::dvec3{0.5, 0.5, 0.5});
+			    glm::dvec3{turtle.position} + glm::dvec3{0.5, 0.5, 0.5});
 			if (distances[0] != -1 && distances[0] < current_min_distance)
 			{
 				current_min_distance = distances[0];
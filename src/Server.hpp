@@ -1,11 +1,26 @@
 #pragma once
 
 #include <memory>
+#include <mutex>
 #include <unordered_map>
+#include <vector>
 
 #include "Common_Networking.hpp"
 
 #include "Computer.hpp"
+#include "Metrics.hpp"
+#include "TimerWheel.hpp"
+#include "Trace.hpp"
+
+// what one computer answered to a broadcast, an object with "error" if it
+// failed or didn't answer in time
+struct BroadcastReply
+{
+	uint32_t connection_id;
+	nlohmann::json response;
+};
+
+using ComputerFilter = std::function<bool(const ComputerInterface &)>;
 
 class server_manager
 {
@@ -35,11 +50,22 @@ class server_manager
 		    this,
 		    std::placeholders::_1));
 
+		m_endpoint.set_http_handler(std::bind(
+		    &server_manager::http_handler,
+		    this,
+		    std::placeholders::_1));
+
 		m_endpoint.set_reuse_addr(true);
+
+		m_collector = metrics().add_collector([this](Metrics &metrics) {
+			collect(metrics);
+		});
 	}
+	~server_manager() { metrics().remove_collector(m_collector); }
 
 	void run()
 	{
+		tracer().name_thread("network");
 		m_endpoint.listen(8080);
 		m_endpoint.start_accept();
 		m_endpoint.run();
@@ -47,6 +73,7 @@ class server_manager
 
 	void send_stops()
 	{
+		std::scoped_lock a{m_computers_mutex};
 		for (auto m_connection = m_computers.begin();
 		     m_connection != m_computers.end();)
 		{
@@ -59,15 +86,31 @@ class server_manager
 	bool scheduler_stop = false;
 	void scheduler()
 	{
+		tracer().name_thread("scheduler");
 		auto start = std::chrono::steady_clock::now();
 		while (!scheduler_stop)
 		{
 			std::this_thread::sleep_for(std::chrono::seconds{0});
 			auto now = std::chrono::steady_clock::now();
 			std::chrono::duration<double> dt = now - start;
-			for (auto &computer : m_computers)
+			// timed out requests take the computer's lock, not this one
+			m_timers.advance(now);
 			{
-				computer.second->scheduler_internal(dt);
+				std::scoped_lock a{m_computers_mutex};
+				for (auto computer = m_computers.begin();
+				     computer != m_computers.end();)
+				{
+					computer->second->scheduler_internal(dt);
+					if (computer->second->dead())
+					{
+						drop(computer->first, *computer->second);
+						computer = m_computers.erase(computer);
+					}
+					else
+					{
+						computer++;
+					}
+				}
 			}
 			start = now;
 		}
@@ -76,9 +119,81 @@ class server_manager
 	void stop()
 	{
 		m_endpoint.stop();
+		std::scoped_lock a{m_computers_mutex};
 		m_computers.clear();
 	}
 
+	// writes all turtle traffic to path from now on, false if the file
+	// can't be written. call before run
+	bool record_to(const std::string &path)
+	{
+		m_recorder = std::make_shared<TrafficRecorder>(path);
+		if (!m_recorder->good())
+		{
+			m_recorder = nullptr;
+			return false;
+		}
+		return true;
+	}
+
+	// sends request to every computer filter picks, or all of them, serialized
+	// once and shared between them. the future has a reply from each in the
+	// order they came in. with a timeout, the ones that haven't answered by
+	// then get an error, without one each request still has its own deadline
+	boost::future<std::vector<BroadcastReply>> broadcast(
+	    nlohmann::json request,
+	    ComputerFilter filter = nullptr,
+	    std::chrono::milliseconds timeout = std::chrono::milliseconds{0})
+	{
+		auto payload = std::make_shared<const std::string>(
+		    ComputerInterface::serialize_request(request));
+		return broadcast(
+		    std::make_shared<const nlohmann::json>(std::move(request)),
+		    std::move(payload),
+		    std::move(filter),
+		    timeout);
+	}
+	// a buffer sent before isn't serialized again
+	template <typename T>
+	boost::future<std::vector<BroadcastReply>> broadcast(
+	    CommandBuffer<T> &buffer,
+	    ComputerFilter filter = nullptr,
+	    std::chrono::milliseconds timeout = std::chrono::milliseconds{0})
+	{
+		auto serialized = buffer.serialized();
+		return broadcast(
+		    serialized->request,
+		    serialized->payload,
+		    std::move(filter),
+		    timeout);
+	}
+	// payload is request serialized, like CommandBuffer::serialized has them
+	boost::future<std::vector<BroadcastReply>> broadcast(
+	    std::shared_ptr<const nlohmann::json> request,
+	    std::shared_ptr<const std::string> payload,
+	    ComputerFilter filter,
+	    std::chrono::milliseconds timeout)
+	{
+		std::vector<std::pair<uint32_t, boost::future<nlohmann::json>>> sent;
+		{
+			std::scoped_lock a{m_computers_mutex};
+			for (auto &[connection, computer] : m_computers)
+			{
+				if (!filter || filter(*computer))
+				{
+					sent.emplace_back(
+					    computer->connection_id(),
+					    computer->submit_serialized(request, payload));
+				}
+			}
+		}
+		static auto &targets = metrics().counter(
+		    "controller_broadcast_targets_total",
+		    "computers broadcasts were sent to");
+		targets.add(sent.size());
+		return gather(std::move(sent), timeout);
+	}
+
 	void register_new_handler(
 	    std::function<void(std::shared_ptr<ComputerInterface>)> new_handler)
 	{
@@ -91,6 +206,9 @@ class server_manager
 	    std::hash<websocketpp::connection_hdl>,
 	    connection_equal>
 	    m_computers;
+	// the network thread adds and removes computers while the scheduler
+	// thread walks them
+	std::mutex m_computers_mutex;
 
 	server m_endpoint;
 
@@ -99,9 +217,18 @@ class server_manager
 	    websocketpp::connection_hdl connection,
 	    server::message_ptr msg)
 	{
-		if (m_computers.find(connection) != m_computers.end())
+		std::shared_ptr<ComputerInterface> computer;
 		{
-			m_computers.at(connection)->recieve(msg);
+			std::scoped_lock a{m_computers_mutex};
+			if (auto found = m_computers.find(connection);
+			    found != m_computers.end())
+			{
+				computer = found->second;
+			}
+		}
+		if (computer)
+		{
+			computer->recieve(msg);
 		}
 		else
 		{
@@ -111,20 +238,204 @@ class server_manager
 
 	void new_handler(websocketpp::connection_hdl connection)
 	{
-		m_computers.emplace(
+		auto id = m_next_connection_id++;
+		if (m_recorder)
+		{
+			m_recorder->record(id, TrafficFrame::opened);
+		}
+		auto computer = std::make_shared<ComputerInterface>(
 		    connection,
-		    std::make_shared<ComputerInterface>(connection, m_endpoint));
+		    m_endpoint,
+		    m_recorder,
+		    id,
+		    &m_timers);
+		{
+			std::scoped_lock a{m_computers_mutex};
+			m_computers.emplace(connection, computer);
+		}
 		std::cout << "computer connected\n";
 		if (m_new_handler)
 		{
-			m_new_handler(m_computers.at(connection));
+			m_new_handler(computer);
+		}
+	}
+
+	// plain http on the turtle port, GET /metrics gives the metrics as
+	// prometheus text
+	void http_handler(websocketpp::connection_hdl connection)
+	{
+		auto http = m_endpoint.get_con_from_hdl(connection);
+		if (http->get_resource() != "/metrics")
+		{
+			http->set_status(websocketpp::http::status_code::not_found);
+			return;
+		}
+		http->set_status(websocketpp::http::status_code::ok);
+		http->append_header("Content-Type", "text/plain; version=0.0.4");
+		http->set_body(metrics().prometheus());
+	}
+
+	// the queues of every connected turtle, by connection
+	void collect(Metrics &metrics)
+	{
+		metrics.clear("controller_turtle_queued_requests");
+		metrics.clear("controller_turtle_requests_in_flight");
+		std::scoped_lock a{m_computers_mutex};
+		for (auto &computer : m_computers)
+		{
+			MetricLabels labels{
+			    {"connection",
+			     std::to_string(computer.second->connection_id())}};
+			metrics
+			    .gauge(
+			        "controller_turtle_queued_requests",
+			        "requests waiting to be sent to a turtle",
+			        labels)
+			    .set(computer.second->queued_requests());
+			metrics
+			    .gauge(
+			        "controller_turtle_requests_in_flight",
+			        "requests sent to a turtle and not answered yet",
+			        labels)
+			    .set(computer.second->requests_in_flight());
+		}
+	}
+
+	struct Gather
+	{
+		std::mutex mutex;
+		std::vector<BroadcastReply> replies;
+		// connection ids of the ones still to answer
+		std::vector<uint32_t> waiting;
+		boost::promise<std::vector<BroadcastReply>> done;
+		bool finished = false;
+
+		// call with mutex, sets done once mutex is let go
+		std::vector<BroadcastReply> finish()
+		{
+			finished = true;
+			waiting.clear();
+			return std::move(replies);
+		}
+	};
+
+	boost::future<std::vector<BroadcastReply>> gather(
+	    std::vector<std::pair<uint32_t, boost::future<nlohmann::json>>> sent,
+	    std::chrono::milliseconds timeout)
+	{
+		auto state = std::make_shared<Gather>();
+		auto result = state->done.get_future();
+		if (sent.empty())
+		{
+			state->done.set_value({});
+			return result;
+		}
+		for (auto &[id, future] : sent)
+		{
+			state->waiting.push_back(id);
+		}
+		if (timeout.count() > 0)
+		{
+			m_timers.schedule(
+			    std::chrono::steady_clock::now() + timeout,
+			    [state]() {
+				    std::vector<BroadcastReply> replies;
+				    {
+					    std::scoped_lock a{state->mutex};
+					    if (state->finished)
+					    {
+						    return;
+					    }
+					    for (auto id : state->waiting)
+					    {
+						    state->replies.push_back(
+						        {id, {{"error", "broadcast timed out"}}});
+					    }
+					    replies = state->finish();
+				    }
+				    state->done.set_value(std::move(replies));
+			    });
 		}
+		// the replies come in on the network thread, or straight away from a
+		// full lane
+		for (auto &[id, future] : sent)
+		{
+			future.then(
+			    boost::launch::sync,
+			    [state, id = id](boost::future<nlohmann::json> reply) {
+				    BroadcastReply gathered{id, {}};
+				    try
+				    {
+					    gathered.response = reply.get();
+				    }
+				    catch (...)
+				    {
+					    gathered.response = {{"error", "request failed"}};
+				    }
+				    std::vector<BroadcastReply> replies;
+				    {
+					    std::scoped_lock a{state->mutex};
+					    if (state->finished)
+					    {
+						    return;
+					    }
+					    std::erase(state->waiting, id);
+					    state->replies.push_back(std::move(gathered));
+					    if (!state->waiting.empty())
+					    {
+						    return;
+					    }
+					    replies = state->finish();
+				    }
+				    state->done.set_value(std::move(replies));
+			    });
+		}
+		return result;
+	}
+
+	// a computer that stopped answering, call with m_computers_mutex. the world
+	// sees its connection expire once it is erased
+	void drop(websocketpp::connection_hdl connection, ComputerInterface &computer)
+	{
+		if (m_recorder)
+		{
+			m_recorder->record(computer.connection_id(), TrafficFrame::closed);
+		}
+		static auto &dropped = metrics().counter(
+		    "controller_turtles_dropped_total",
+		    "turtles dropped for not answering");
+		dropped.add();
+		// it may already be gone
+		websocketpp::lib::error_code error;
+		m_endpoint.close(
+		    connection,
+		    websocketpp::close::status::going_away,
+		    "not answering",
+		    error);
 	}
 
 	void close_handler(websocketpp::connection_hdl connection)
 	{
-		m_computers.erase(connection);
+		std::scoped_lock a{m_computers_mutex};
+		if (auto found = m_computers.find(connection);
+		    found != m_computers.end())
+		{
+			if (m_recorder)
+			{
+				m_recorder->record(
+				    found->second->connection_id(),
+				    TrafficFrame::closed);
+			}
+			m_computers.erase(found);
+		}
 	}
 
 	std::function<void(std::shared_ptr<ComputerInterface>)> m_new_handler;
+	std::shared_ptr<TrafficRecorder> m_recorder;
+	size_t m_collector;
+	// deadlines of the requests sent to every computer, advanced by the
+	// scheduler thread
+	TimerWheel m_timers;
+	// only touched by the network thread
+	uint32_t m_next_connection_id = 1;
 };
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// deadlines that are nearly always cancelled before they come due, one for
+// every request in flight to every turtle. a deadline goes into the slot of
+// the tick it falls in, advancing only looks at the slots of the ticks that
+// went by since and cancelling only at the one slot. deadlines further out
+// than a turn of the wheel wait in their slot until their turn comes around
+class TimerWheel
+{
+	public:
+	using clock = std::chrono::steady_clock;
+	using id = uint64_t;
+
+	explicit TimerWheel(
+	    std::chrono::milliseconds tick = std::chrono::milliseconds{100},
+	    size_t slots = 512)
+	    : m_tick(tick), m_start(clock::now()), m_slots(slots)
+	{
+	}
+
+	// callback runs on the thread advancing the wheel, no earlier than
+	// deadline and up to a tick after it
+	id schedule(clock::time_point deadline, std::function<void()> callback)
+	{
+		std::scoped_lock a{m_mutex};
+		auto tick = std::max(tick_of(deadline) + 1, m_next_tick);
+		auto timer = m_next_id++;
+		m_slots[tick % m_slots.size()].push_back(
+		    {timer, tick, std::move(callback)});
+		m_tick_of.emplace(timer, tick);
+		return timer;
+	}
+
+	// nothing if it already ran or was cancelled
+	void cancel(id timer)
+	{
+		std::scoped_lock a{m_mutex};
+		auto found = m_tick_of.find(timer);
+		if (found == m_tick_of.end())
+		{
+			return;
+		}
+		auto &slot = m_slots[found->second % m_slots.size()];
+		std::erase_if(slot, [timer](auto &t) { return t.timer == timer; });
+		m_tick_of.erase(found);
+	}
+
+	// runs everything due by now, without holding the wheel so callbacks can
+	// schedule and cancel. gives back how many ran
+	size_t advance(clock::time_point now = clock::now())
+	{
+		std::vector<std::function<void()>> due;
+		{
+			std::scoped_lock a{m_mutex};
+			auto last = tick_of(now);
+			if (last < m_next_tick)
+			{
+				return 0;
+			}
+			auto passed = std::min<uint64_t>(
+			    last - m_next_tick + 1,
+			    m_slots.size());
+			for (uint64_t tick = m_next_tick; tick < m_next_tick + passed;
+			     tick++)
+			{
+				auto &slot = m_slots[tick % m_slots.size()];
+				auto later = std::partition(
+				    slot.begin(),
+				    slot.end(),
+				    [last](auto &t) { return t.tick > last; });
+				for (auto t = later; t != slot.end(); t++)
+				{
+					due.push_back(std::move(t->callback));
+					m_tick_of.erase(t->timer);
+				}
+				slot.erase(later, slot.end());
+			}
+			m_next_tick = last + 1;
+		}
+		for (auto &callback : due)
+		{
+			callback();
+		}
+		return due.size();
+	}
+
+	size_t size()
+	{
+		std::scoped_lock a{m_mutex};
+		return m_tick_of.size();
+	}
+
+	private:
+	struct Timer
+	{
+		id timer;
+		uint64_t tick;
+		std::function<void()> callback;
+	};
+
+	uint64_t tick_of(clock::time_point time) const
+	{
+		if (time < m_start)
+		{
+			return 0;
+		}
+		return (time - m_start) / m_tick;
+	}
+
+	std::mutex m_mutex;
+	std::chrono::milliseconds m_tick;
+	clock::time_point m_start;
+	std::vector<std::vector<Timer>> m_slots;
+	std::unordered_map<id, uint64_t> m_tick_of;
+	// every tick before this one has been run
+	uint64_t m_next_tick = 0;
+	id m_next_id = 1;
+};
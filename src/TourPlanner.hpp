@@ -0,0 +1,241 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <glm/ext.hpp>
+#include <glm/gtx/hash.hpp>
+
+// walking distances between every pair of points, one breadth first search
+// from each point that stops once it has seen all the others or looked at
+// max_expansions blocks. the searches stay within margin blocks of the box
+// around the points, a detour further out than that isn't worth knowing
+// about. the points themselves count as free even if the obstacle function
+// says otherwise, they are usually the blocks the turtle is going to work
+// on. pairs that weren't found get the manhattan distance, which is what
+// they would be in the open
+inline std::vector<std::vector<double>> path_distances(
+    const std::vector<glm::ivec3> &points,
+    const std::function<bool(glm::ivec3)> &obstacle,
+    size_t max_expansions = 10000,
+    int margin = 8)
+{
+	if (points.empty())
+	{
+		return {};
+	}
+	auto low = points[0], high = points[0];
+	for (auto &point : points)
+	{
+		low = glm::min(low, point);
+		high = glm::max(high, point);
+	}
+	low -= glm::ivec3{margin};
+	high += glm::ivec3{margin};
+	auto outside = [&](glm::ivec3 position) {
+		return position.x < low.x || position.y < low.y || position.z < low.z
+		       || position.x > high.x || position.y > high.y
+		       || position.z > high.z;
+	};
+	std::vector<std::vector<double>> distances(
+	    points.size(),
+	    std::vector<double>(points.size()));
+	for (size_t from = 0; from < points.size(); from++)
+	{
+		for (size_t to = 0; to < points.size(); to++)
+		{
+			auto difference = glm::abs(points[to] - points[from]);
+			distances[from][to] = difference.x + difference.y + difference.z;
+		}
+	}
+	std::unordered_map<glm::ivec3, std::vector<size_t>> point_indices;
+	for (size_t i = 0; i < points.size(); i++)
+	{
+		point_indices[points[i]].push_back(i);
+	}
+	constexpr std::array<glm::ivec3, 6> directions{
+	    glm::ivec3{-1, 0, 0},
+	    glm::ivec3{1, 0, 0},
+	    glm::ivec3{0, -1, 0},
+	    glm::ivec3{0, 1, 0},
+	    glm::ivec3{0, 0, -1},
+	    glm::ivec3{0, 0, 1}};
+	for (size_t from = 0; from < points.size(); from++)
+	{
+		std::unordered_set<glm::ivec3> seen{points[from]};
+		seen.reserve(max_expansions);
+		std::deque<std::pair<glm::ivec3, int>> frontier{{points[from], 0}};
+		size_t found = 0;
+		while (!frontier.empty() && found < points.size()
+		       && seen.size() < max_expansions)
+		{
+			auto [position, distance] = frontier.front();
+			frontier.pop_front();
+			if (auto here = point_indices.find(position);
+			    here != point_indices.end())
+			{
+				for (auto to : here->second)
+				{
+					distances[from][to] = distance;
+					found++;
+				}
+			}
+			for (auto &direction : directions)
+			{
+				auto next = position + direction;
+				if (outside(next) || seen.contains(next)
+				    || (obstacle(next) && !point_indices.contains(next)))
+				{
+					continue;
+				}
+				seen.insert(next);
+				frontier.emplace_back(next, distance + 1);
+			}
+		}
+	}
+	return distances;
+}
+
+// order to visit stops 1..n in, starting at 0 and not coming back. nearest
+// neighbour to get going then 2-opt until no reversal makes it shorter.
+// the returned order doesn't include the start
+inline std::vector<size_t>
+plan_tour(const std::vector<std::vector<double>> &distance)
+{
+	size_t count = distance.size();
+	std::vector<size_t> tour{0};
+	std::vector<bool> visited(count, false);
+	visited[0] = true;
+	for (size_t step = 1; step < count; step++)
+	{
+		size_t current = tour.back();
+		size_t next = 0;
+		double best = std::numeric_limits<double>::infinity();
+		for (size_t candidate = 1; candidate < count; candidate++)
+		{
+			if (!visited[candidate]
+			    && (next == 0 || distance[current][candidate] < best))
+			{
+				next = candidate;
+				best = distance[current][candidate];
+			}
+		}
+		visited[next] = true;
+		tour.push_back(next);
+	}
+
+	// an open path, reversing tour[i..j] swaps the edges on both ends of it
+	// and there is no edge after the last stop
+	auto edge = [&](size_t a, size_t b) {
+		return b >= tour.size() ? 0.0 : distance[tour[a]][tour[b]];
+	};
+	bool improved = true;
+	while (improved)
+	{
+		improved = false;
+		for (size_t i = 1; i + 1 < tour.size(); i++)
+		{
+			for (size_t j = i + 1; j < tour.size(); j++)
+			{
+				double before = edge(i - 1, i) + edge(j, j + 1);
+				double after = distance[tour[i - 1]][tour[j]]
+				               + (j + 1 < tour.size()
+				                      ? distance[tour[i]][tour[j + 1]]
+				                      : 0.0);
+				if (after + 1e-9 < before)
+				{
+					std::reverse(tour.begin() + i, tour.begin() + j + 1);
+					improved = true;
+				}
+			}
+		}
+	}
+	tour.erase(tour.begin());
+	return tour;
+}
+
+// hands out points that didn't start a tour of their own to the tours that
+// have fewer than max_stops stops. the point closest to any stop of a tour
+// goes next, so tours grow outwards from where they started instead of
+// picking up points in whatever order they came. tours and left_over are
+// indices into positions, the points no tour had room for are returned
+inline std::vector<size_t> grow_tours(
+    const std::vector<glm::ivec3> &positions,
+    std::vector<std::vector<size_t>> &tours,
+    const std::vector<size_t> &left_over,
+    size_t max_stops)
+{
+	auto distance = [&](size_t a, size_t b) {
+		auto difference = positions[a] - positions[b];
+		return int64_t{difference.x} * difference.x
+		       + int64_t{difference.y} * difference.y
+		       + int64_t{difference.z} * difference.z;
+	};
+	constexpr auto far = std::numeric_limits<int64_t>::max();
+	// closest[l][t]: squared distance from left_over[l] to tour t
+	std::vector<std::vector<int64_t>> closest(
+	    left_over.size(),
+	    std::vector<int64_t>(tours.size(), far));
+	for (size_t l = 0; l < left_over.size(); l++)
+	{
+		for (size_t t = 0; t < tours.size(); t++)
+		{
+			for (auto stop : tours[t])
+			{
+				closest[l][t]
+				    = std::min(closest[l][t], distance(left_over[l], stop));
+			}
+		}
+	}
+	std::vector<bool> placed(left_over.size(), false);
+	while (true)
+	{
+		size_t best_point = 0, best_tour = 0;
+		int64_t best = far;
+		for (size_t l = 0; l < left_over.size(); l++)
+		{
+			if (placed[l])
+			{
+				continue;
+			}
+			for (size_t t = 0; t < tours.size(); t++)
+			{
+				if (tours[t].size() < max_stops && closest[l][t] < best)
+				{
+					best = closest[l][t];
+					best_point = l;
+					best_tour = t;
+				}
+			}
+		}
+		if (best == far)
+		{
+			break;
+		}
+		placed[best_point] = true;
+		tours[best_tour].push_back(left_over[best_point]);
+		for (size_t l = 0; l < left_over.size(); l++)
+		{
+			closest[l][best_tour] = std::min(
+			    closest[l][best_tour],
+			    distance(left_over[l], left_over[best_point]));
+		}
+	}
+	std::vector<size_t> unplaced;
+	for (size_t l = 0; l < left_over.size(); l++)
+	{
+		if (!placed[l])
+		{
+			unplaced.push_back(left_over[l]);
+		}
+	}
+	return unplaced;
+}
@@ -0,0 +1,214 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// spans of time on every thread, written out as a chrome trace (load it in
+// chrome://tracing or ui.perfetto.dev) to see where a slow frame or a slow
+// reply went. recording is off until started and costs one atomic load per
+// span while off. each thread writes into a buffer of its own, the tracer only
+// takes them when writing the trace
+
+class Tracer
+{
+	public:
+	using clock = std::chrono::steady_clock;
+
+	// a thread stops recording when its buffer has this many spans, until the
+	// trace is written
+	constexpr static size_t max_spans_per_thread = 1 << 20;
+
+	// names and categories have to outlive the tracer, string literals
+	struct Span
+	{
+		const char *name;
+		const char *category;
+		clock::time_point start;
+		clock::time_point end;
+	};
+
+	// drops anything recorded before
+	void start()
+	{
+		clear();
+		m_active.store(true, std::memory_order_relaxed);
+	}
+	void stop() { m_active.store(false, std::memory_order_relaxed); }
+	bool active() const { return m_active.load(std::memory_order_relaxed); }
+
+	// how the calling thread shows up in the trace
+	void name_thread(std::string name)
+	{
+		auto &buffer = this_thread_buffer();
+		std::scoped_lock a{buffer.mutex};
+		buffer.name = std::move(name);
+	}
+
+	void record(const Span &span)
+	{
+		if (!active())
+		{
+			return;
+		}
+		auto &buffer = this_thread_buffer();
+		std::scoped_lock a{buffer.mutex};
+		if (buffer.spans.size() < max_spans_per_thread)
+		{
+			buffer.spans.push_back(span);
+		}
+	}
+
+	// everything recorded since start or the last write, which is dropped
+	// afterwards. recording carries on if it was on. false if path can't be
+	// written
+	bool write(const std::string &path)
+	{
+		std::ofstream file{path, std::ios::trunc};
+		if (!file)
+		{
+			return false;
+		}
+		file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+		bool first = true;
+		auto separate = [&]() {
+			if (!first)
+			{
+				file << ",\n";
+			}
+			first = false;
+		};
+		std::scoped_lock a{m_buffers_mutex};
+		for (auto &buffer : m_buffers)
+		{
+			std::vector<Span> spans;
+			std::string name;
+			{
+				std::scoped_lock b{buffer->mutex};
+				spans.swap(buffer->spans);
+				name = buffer->name;
+			}
+			if (!name.empty())
+			{
+				separate();
+				file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+				     << "\"tid\":" << buffer->id << ",\"args\":{\"name\":\""
+				     << name << "\"}}";
+			}
+			for (auto &span : spans)
+			{
+				separate();
+				file << "{\"name\":\"" << span.name << "\",\"cat\":\""
+				     << span.category << "\",\"ph\":\"X\",\"ts\":"
+				     << microseconds(span.start) << ",\"dur\":"
+				     << microseconds(span.end) - microseconds(span.start)
+				     << ",\"pid\":1,\"tid\":" << buffer->id << '}';
+			}
+		}
+		file << "]}\n";
+		forget_finished_threads();
+		return file.good();
+	}
+
+	private:
+	struct ThreadBuffer
+	{
+		uint32_t id;
+		std::mutex mutex;
+		std::string name;
+		std::vector<Span> spans;
+	};
+
+	ThreadBuffer &this_thread_buffer()
+	{
+		// the tracer keeps it too, so what a thread recorded outlives it
+		thread_local std::shared_ptr<ThreadBuffer> buffer;
+		if (!buffer)
+		{
+			buffer = std::make_shared<ThreadBuffer>();
+			std::scoped_lock a{m_buffers_mutex};
+			buffer->id = m_next_thread_id++;
+			m_buffers.push_back(buffer);
+		}
+		return *buffer;
+	}
+
+	void clear()
+	{
+		std::scoped_lock a{m_buffers_mutex};
+		for (auto &buffer : m_buffers)
+		{
+			std::scoped_lock b{buffer->mutex};
+			buffer->spans.clear();
+		}
+		forget_finished_threads();
+	}
+
+	// searches run on threads of their own, don't keep one buffer for each
+	// search ever run. a thread that ended after its buffer was written may
+	// have left spans for the next write. call with m_buffers_mutex
+	void forget_finished_threads()
+	{
+		std::erase_if(m_buffers, [](auto &buffer) {
+			std::scoped_lock a{buffer->mutex};
+			return buffer.use_count() == 1 && buffer->spans.empty();
+		});
+	}
+
+	int64_t microseconds(clock::time_point time) const
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(
+		           time - m_epoch)
+		    .count();
+	}
+
+	std::atomic<bool> m_active = false;
+	clock::time_point m_epoch = clock::now();
+	std::mutex m_buffers_mutex;
+	std::vector<std::shared_ptr<ThreadBuffer>> m_buffers;
+	uint32_t m_next_thread_id = 1;
+};
+
+inline Tracer &tracer()
+{
+	static Tracer instance;
+	return instance;
+}
+
+// records the time from its construction to end or its destruction
+class TraceSpan
+{
+	public:
+	explicit TraceSpan(const char *name, const char *category = "controller")
+	    : m_name(name), m_category(category), m_recording(tracer().active())
+	{
+		if (m_recording)
+		{
+			m_start = Tracer::clock::now();
+		}
+	}
+	~TraceSpan() { end(); }
+	TraceSpan(const TraceSpan &) = delete;
+	TraceSpan &operator=(const TraceSpan &) = delete;
+
+	void end()
+	{
+		if (m_recording)
+		{
+			m_recording = false;
+			tracer().record(
+			    {m_name, m_category, m_start, Tracer::clock::now()});
+		}
+	}
+
+	private:
+	const char *m_name;
+	const char *m_category;
+	bool m_recording;
+	Tracer::clock::time_point m_start;
+};
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <string>
+
+// a frame as it went over a turtle's websocket, or a turtle connecting or
+// going away. times are from when the recording started
+struct TrafficFrame
+{
+	enum kinds : uint8_t
+	{
+		opened,
+		closed,
+		inbound,
+		outbound
+	};
+
+	uint64_t microseconds = 0;
+	uint32_t connection = 0;
+	kinds kind = inbound;
+	std::string payload;
+};
+
+// capture files are a magic string and then one record per frame: time,
+// connection, kind and payload size in host byte order, then the payload.
+// they are meant to be replayed on the machine that recorded them
+constexpr char traffic_magic[8] = {'C', 'C', 'W', 'S', 'C', 'A', 'P', '1'};
+
+// appends frames to a capture file, from any thread
+class TrafficRecorder
+{
+	public:
+	explicit TrafficRecorder(const std::string &path)
+	    : m_file(path, std::ios::binary | std::ios::trunc),
+	      m_start(std::chrono::steady_clock::now())
+	{
+		m_file.write(traffic_magic, sizeof(traffic_magic));
+	}
+
+	bool good() const { return m_file.good(); }
+
+	void record(
+	    uint32_t connection,
+	    TrafficFrame::kinds kind,
+	    const std::string &payload = {})
+	{
+		uint64_t microseconds
+		    = std::chrono::duration_cast<std::chrono::microseconds>(
+		          std::chrono::steady_clock::now() - m_start)
+		          .count();
+		uint32_t size = payload.size();
+		std::scoped_lock a{m_mutex};
+		m_file.write(reinterpret_cast<const char *>(&microseconds), 8);
+		m_file.write(reinterpret_cast<const char *>(&connection), 4);
+		m_file.write(reinterpret_cast<const char *>(&kind), 1);
+		m_file.write(reinterpret_cast<const char *>(&size), 4);
+		m_file.write(payload.data(), size);
+	}
+
+	private:
+	std::mutex m_mutex;
+	std::ofstream m_file;
+	std::chrono::steady_clock::time_point m_start;
+};
+
+// reads a capture back frame by frame
+class TrafficLog
+{
+	public:
+	explicit TrafficLog(const std::string &path)
+	    : m_file(path, std::ios::binary)
+	{
+		char magic[sizeof(traffic_magic)];
+		m_file.read(magic, sizeof(magic));
+		m_valid = m_file.good()
+		          && std::equal(magic, magic + sizeof(magic), traffic_magic);
+	}
+
+	// false if the file couldn't be opened or isn't a capture
+	bool valid() const { return m_valid; }
+
+	// nullopt at the end, a frame cut short by a crash counts as the end
+	std::optional<TrafficFrame> next()
+	{
+		if (!m_valid)
+		{
+			return std::nullopt;
+		}
+		TrafficFrame frame;
+		uint32_t size = 0;
+		m_file.read(reinterpret_cast<char *>(&frame.microseconds), 8);
+		m_file.read(reinterpret_cast<char *>(&frame.connection), 4);
+		m_file.read(reinterpret_cast<char *>(&frame.kind), 1);
+		m_file.read(reinterpret_cast<char *>(&size), 4);
+		if (!m_file)
+		{
+			return std::nullopt;
+		}
+		frame.payload.resize(size);
+		m_file.read(frame.payload.data(), size);
+		if (!m_file)
+		{
+			return std::nullopt;
+		}
+		return frame;
+	}
+
+	private:
+	std::ifstream m_file;
+	bool m_valid = false;
+};
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+
+#include "TrafficRecorder.hpp"
+#include "world.hpp"
+
+// feeds a capture into a world as if the turtles in it were connected. a
+// turtle that connects goes through World::new_turtle like it would from the
+// server, what it sent goes to its ComputerInterface and the world handles
+// that through the executor, which the replay runs after every frame. where
+// the capture sent a request the world's next queued request is sent, so
+// replies line up as long as the world asks what it asked when recording.
+// pushes, block scans and positions, replay exactly either way
+class TrafficReplay
+{
+	public:
+	using clock = std::chrono::steady_clock;
+
+	struct Totals
+	{
+		size_t frames = 0;
+		size_t inbound_bytes = 0;
+		std::chrono::duration<double> elapsed{0};
+	};
+
+	explicit TrafficReplay(World &world) : m_world(world) {}
+
+	// runs after every frame, holding the world
+	std::function<void(World &)> after_frame;
+
+	void play(const TrafficFrame &frame)
+	{
+		switch (frame.kind)
+		{
+		case TrafficFrame::opened:
+		{
+			auto computer = std::make_shared<ComputerInterface>(
+			    websocketpp::connection_hdl{},
+			    m_endpoint);
+			m_computers[frame.connection] = computer;
+			m_world.new_turtle(computer);
+			break;
+		}
+		case TrafficFrame::closed:
+			m_computers.erase(frame.connection);
+			break;
+		case TrafficFrame::outbound:
+			if (auto computer = m_computers.find(frame.connection);
+			    computer != m_computers.end() && frame.payload != "wake_up")
+			{
+				computer->second->send_next_request();
+			}
+			break;
+		case TrafficFrame::inbound:
+			if (auto computer = m_computers.find(frame.connection);
+			    computer != m_computers.end())
+			{
+				computer->second->recieve(frame.payload);
+			}
+			break;
+		}
+		WorldLock lock{m_world.world_mutex};
+		m_world.executor.run_pending();
+		if (after_frame)
+		{
+			after_frame(m_world);
+		}
+	}
+
+	// at the speed it was recorded, or as fast as the world takes it
+	Totals replay(TrafficLog &log, bool recorded_speed)
+	{
+		Totals totals;
+		auto start = clock::now();
+		while (auto frame = log.next())
+		{
+			if (recorded_speed)
+			{
+				std::this_thread::sleep_until(
+				    start + std::chrono::microseconds{frame->microseconds});
+			}
+			play(*frame);
+			totals.frames++;
+			if (frame->kind == TrafficFrame::inbound)
+			{
+				totals.inbound_bytes += frame->payload.size();
+			}
+		}
+		// replies resolve futures whose continuations post from their own
+		// threads, give the last of them a moment
+		m_world.executor.wait(clock::now() + std::chrono::milliseconds{50});
+		{
+			WorldLock lock{m_world.world_mutex};
+			m_world.executor.run_pending();
+		}
+		totals.elapsed = clock::now() - start;
+		return totals;
+	}
+
+	private:
+	World &m_world;
+	// never listens, sends to the replayed turtles go nowhere
+	server m_endpoint;
+	std::unordered_map<uint32_t, std::shared_ptr<ComputerInterface>>
+	    m_computers;
+};
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/ext.hpp>
+#include <glm/gtx/hash.hpp>
+
+// uniform grid over turtle positions per dimension, turtles are referred to by
+// their index in World::m_turtles. the cells are 16x16 columns, worlds are a
+// lot wider than they are tall. nearest() searches outwards ring by ring and
+// falls back to looking at every turtle in the dimension once the rings would
+// cost more than that
+class TurtleIndex
+{
+	public:
+	constexpr static int cell_shift = 4; // 16 block columns
+	// looking up a cell costs about this many turtle distance checks
+	constexpr static size_t cell_cost = 8;
+	using predicate = std::function<bool(size_t)>;
+
+	void update(
+	    size_t index,
+	    const std::string &server,
+	    const std::string &dimension,
+	    glm::ivec3 position)
+	{
+		std::scoped_lock a{m_mutex};
+		if (index < m_entries.size() && m_entries[index])
+		{
+			auto &old = *m_entries[index];
+			if (old.server == server && old.dimension == dimension
+			    && old.position == position)
+			{
+				return;
+			}
+			remove_impl(index);
+		}
+		if (index >= m_entries.size())
+		{
+			m_entries.resize(index + 1);
+		}
+		m_entries[index] = Entry{server, dimension, position};
+		auto &grid = m_grids[server][dimension];
+		auto cell = cell_of(position);
+		grid.cells[cell].push_back(index);
+		grid.members.push_back(index);
+		if (grid.members.size() == 1)
+		{
+			grid.min_cell = grid.max_cell = cell;
+		}
+		grid.min_cell = glm::min(grid.min_cell, cell);
+		grid.max_cell = glm::max(grid.max_cell, cell);
+	}
+
+	void remove(size_t index)
+	{
+		std::scoped_lock a{m_mutex};
+		remove_impl(index);
+	}
+
+	void clear()
+	{
+		std::scoped_lock a{m_mutex};
+		m_entries.clear();
+		m_grids.clear();
+	}
+
+	// the closest turtle accepted by wanted, straight line distance
+	std::optional<size_t> nearest(
+	    const std::string &server,
+	    const std::string &dimension,
+	    glm::ivec3 position,
+	    const predicate &wanted)
+	{
+		std::scoped_lock a{m_mutex};
+		auto dimensions = m_grids.find(server);
+		if (dimensions == m_grids.end())
+		{
+			return std::nullopt;
+		}
+		auto found = dimensions->second.find(dimension);
+		if (found == dimensions->second.end() || found->second.members.empty())
+		{
+			return std::nullopt;
+		}
+		auto &grid = found->second;
+
+		std::optional<size_t> best;
+		// squared, compared against squared ring distances as well
+		int64_t best_distance = std::numeric_limits<int64_t>::max();
+		auto consider = [&](size_t index) {
+			auto difference = m_entries[index]->position - position;
+			auto distance = int64_t{difference.x} * difference.x
+			                + int64_t{difference.y} * difference.y
+			                + int64_t{difference.z} * difference.z;
+			if (distance < best_distance && wanted(index))
+			{
+				best = index;
+				best_distance = distance;
+			}
+		};
+
+		auto center = cell_of(position);
+		auto reach = glm::max(
+		    glm::abs(grid.max_cell - center),
+		    glm::abs(grid.min_cell - center));
+		int max_ring = std::max(reach.x, reach.y);
+		size_t cells_looked_at = 0;
+		for (int ring = 0; ring <= max_ring; ring++)
+		{
+			// everything in this ring is at least this far away
+			int64_t ring_distance = int64_t{ring - 1} * (1 << cell_shift);
+			if (ring > 0 && ring_distance * ring_distance > best_distance)
+			{
+				break;
+			}
+			size_t ring_cells = ring == 0 ? 1 : 8 * ring;
+			if ((cells_looked_at + ring_cells) * cell_cost > grid.members.size())
+			{
+				for (auto index : grid.members)
+				{
+					consider(index);
+				}
+				return best;
+			}
+			cells_looked_at += ring_cells;
+			for_each_cell_in_ring(center, ring, [&](glm::ivec2 cell) {
+				if (auto members = grid.cells.find(cell);
+				    members != grid.cells.end())
+				{
+					for (auto index : members->second)
+					{
+						consider(index);
+					}
+				}
+			});
+		}
+		return best;
+	}
+
+	private:
+	struct Entry
+	{
+		std::string server;
+		std::string dimension;
+		glm::ivec3 position;
+	};
+	struct Grid
+	{
+		std::unordered_map<glm::ivec2, std::vector<size_t>> cells;
+		std::vector<size_t> members;
+		// only ever grows, a turtle leaving the edge doesn't shrink it
+		glm::ivec2 min_cell{0};
+		glm::ivec2 max_cell{0};
+	};
+
+	static glm::ivec2 cell_of(glm::ivec3 position)
+	{
+		return glm::ivec2{position.x >> cell_shift, position.z >> cell_shift};
+	}
+
+	template <typename F>
+	static void for_each_cell_in_ring(glm::ivec2 center, int ring, F &&f)
+	{
+		if (ring == 0)
+		{
+			f(center);
+			return;
+		}
+		for (int i = -ring; i < ring; i++)
+		{
+			f(center + glm::ivec2{i, -ring});
+			f(center + glm::ivec2{ring, i});
+			f(center + glm::ivec2{-i, ring});
+			f(center + glm::ivec2{-ring, -i});
+		}
+	}
+
+	static void erase_one(std::vector<size_t> &from, size_t index)
+	{
+		for (auto &member : from)
+		{
+			if (member == index)
+			{
+				member = from.back();
+				from.pop_back();
+				return;
+			}
+		}
+	}
+
+	void remove_impl(size_t index)
+	{
+		if (index >= m_entries.size() || !m_entries[index])
+		{
+			return;
+		}
+		auto &entry = *m_entries[index];
+		auto &grid = m_grids[entry.server][entry.dimension];
+		auto cell = grid.cells.find(cell_of(entry.position));
+		if (cell != grid.cells.end())
+		{
+			erase_one(cell->second, index);
+			if (cell->second.empty())
+			{
+				grid.cells.erase(cell);
+			}
+		}
+		erase_one(grid.members, index);
+		m_entries[index] = std::nullopt;
+	}
+
+	std::mutex m_mutex;
+	std::vector<std::optional<Entry>> m_entries;
+	// server -> dimension -> grid
+	std::unordered_map<std::string, std::unordered_map<std::string, Grid>>
+	    m_grids;
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <coroutine>
+#include <functional>
+#include <memory>
+
+#include "Metrics.hpp"
+
+// a turtle behaviour written as a coroutine. it runs up to its first
+// co_await straight away, from then on whatever it waits for resumes it
+// through the executor, on the thread that owns the world, so any number
+// of them share that one thread. dropping the task destroys the coroutine
+// wherever it is suspended, a resumption already on its way is skipped. one
+// that throws is counted and ends there, without taking the executor with it
+class TurtleTask
+{
+	struct Frame
+	{
+		std::coroutine_handle<> handle;
+		bool failed = false;
+		~Frame() { handle.destroy(); }
+	};
+
+	public:
+	struct promise_type
+	{
+		std::weak_ptr<Frame> frame;
+
+		TurtleTask get_return_object()
+		{
+			auto owned = std::make_shared<Frame>(
+			    std::coroutine_handle<promise_type>::from_promise(*this));
+			frame = owned;
+			return TurtleTask{std::move(owned)};
+		}
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		// stays around until the task is dropped, so done() can be asked
+		std::suspend_always final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception()
+		{
+			if (auto owned = frame.lock())
+			{
+				owned->failed = true;
+			}
+			static auto &failures = metrics().counter(
+			    "controller_turtle_task_failures_total",
+			    "turtle tasks that ended by throwing");
+			failures.add();
+		}
+	};
+	using handle_type = std::coroutine_handle<promise_type>;
+
+	bool done() const { return m_frame->handle.done(); }
+	// done because it threw
+	bool failed() const { return m_frame->failed; }
+
+	// for awaitables, resumes the coroutine unless the task is gone by then
+	static std::function<void()> resumer(handle_type handle)
+	{
+		return [frame = handle.promise().frame]() {
+			if (auto alive = frame.lock())
+			{
+				alive->handle.resume();
+			}
+		};
+	}
+
+	private:
+	explicit TurtleTask(std::shared_ptr<Frame> frame)
+	    : m_frame(std::move(frame))
+	{
+	}
+	std::shared_ptr<Frame> m_frame;
+};
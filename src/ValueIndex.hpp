@@ -0,0 +1,151 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <glm/ext.hpp>
+#include <glm/gtx/hash.hpp>
+
+// where the blocks with a value are, by what they are used for and which jobs
+// look after them, so nobody has to walk the world to find them. use and jobs
+// are the bit masks from BlockValue and TurtleValue, a block with several use
+// flags is filed under each of them
+class ValueIndex
+{
+	public:
+	constexpr static int any = ~0;
+
+	void add(
+	    const std::string &server,
+	    const std::string &dimension,
+	    glm::ivec3 position,
+	    int use,
+	    int jobs)
+	{
+		std::scoped_lock a{m_mutex};
+		for_each_bit(use, [&](int use_flag) {
+			m_index[server][dimension][use_flag][jobs].insert(position);
+		});
+	}
+
+	void remove(
+	    const std::string &server,
+	    const std::string &dimension,
+	    glm::ivec3 position,
+	    int use,
+	    int jobs)
+	{
+		std::scoped_lock a{m_mutex};
+		auto uses = find_uses(server, dimension);
+		if (!uses)
+		{
+			return;
+		}
+		for_each_bit(use, [&](int use_flag) {
+			if (auto by_job = uses->find(use_flag); by_job != uses->end())
+			{
+				if (auto positions = by_job->second.find(jobs);
+				    positions != by_job->second.end())
+				{
+					positions->second.erase(position);
+				}
+			}
+		});
+	}
+
+	// positions with any of the use flags, looked after by any of the jobs.
+	// blocks with no jobs at all only turn up for jobs = any
+	std::vector<glm::ivec3> find(
+	    const std::string &server,
+	    const std::string &dimension,
+	    int use = any,
+	    int jobs = any)
+	{
+		std::scoped_lock a{m_mutex};
+		std::vector<glm::ivec3> found;
+		auto uses = find_uses(server, dimension);
+		if (!uses)
+		{
+			return found;
+		}
+		std::unordered_set<glm::ivec3> seen;
+		for (auto &[use_flag, by_job] : *uses)
+		{
+			if (!(use_flag & use))
+			{
+				continue;
+			}
+			for (auto &[job_mask, positions] : by_job)
+			{
+				if (!(job_mask & jobs) && jobs != any)
+				{
+					continue;
+				}
+				for (auto &position : positions)
+				{
+					if (seen.insert(position).second)
+					{
+						found.push_back(position);
+					}
+				}
+			}
+		}
+		return found;
+	}
+
+	std::vector<std::string> dimensions(const std::string &server)
+	{
+		std::scoped_lock a{m_mutex};
+		std::vector<std::string> found;
+		if (auto dimensions = m_index.find(server); dimensions != m_index.end())
+		{
+			for (auto &dimension : dimensions->second)
+			{
+				found.push_back(dimension.first);
+			}
+		}
+		return found;
+	}
+
+	void clear()
+	{
+		std::scoped_lock a{m_mutex};
+		m_index.clear();
+	}
+
+	private:
+	using by_use = std::unordered_map<
+	    int,
+	    std::unordered_map<int, std::unordered_set<glm::ivec3>>>;
+
+	by_use *find_uses(const std::string &server, const std::string &dimension)
+	{
+		auto dimensions = m_index.find(server);
+		if (dimensions == m_index.end())
+		{
+			return nullptr;
+		}
+		auto uses = dimensions->second.find(dimension);
+		return uses == dimensions->second.end() ? nullptr : &uses->second;
+	}
+
+	template <typename F>
+	static void for_each_bit(int mask, F &&f)
+	{
+		for (int bit = 1; bit != 0 && bit <= mask; bit <<= 1)
+		{
+			if (mask & bit)
+			{
+				f(bit);
+			}
+		}
+	}
+
+	std::mutex m_mutex;
+	// server -> dimension -> use flag -> jobs -> positions
+	std::unordered_map<std::string, std::unordered_map<std::string, by_use>>
+	    m_index;
+};
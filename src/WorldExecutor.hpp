@@ -0,0 +1,78 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include <boost/thread/shared_mutex.hpp>
+
+// the world belongs to whichever thread holds its mutex through one of these,
+// the automation engine's thread between frames and the gui thread while it
+// draws. held_here lets code that is reached both from the owner and from
+// planner threads know whether it still has to take the lock itself. boost's
+// shared_mutex stops handing out shared locks once a thread waits for the
+// exclusive one, with planners reading all the time the pthread one never
+// lets the owner back in
+class WorldLock
+{
+	public:
+	explicit WorldLock(boost::shared_mutex &mutex) : m_lock{mutex}
+	{
+		held_here = true;
+	}
+	~WorldLock() { held_here = false; }
+	WorldLock(const WorldLock &) = delete;
+	WorldLock &operator=(const WorldLock &) = delete;
+
+	inline static thread_local bool held_here = false;
+
+	private:
+	boost::unique_lock<boost::shared_mutex> m_lock;
+};
+
+// work for the world handed over from threads that don't own it, the network
+// thread mostly. it runs in the order it was posted the next time the owner
+// calls run_pending
+class WorldExecutor
+{
+	public:
+	using clock = std::chrono::steady_clock;
+
+	void post(std::function<void()> work)
+	{
+		{
+			std::scoped_lock a{m_mutex};
+			m_pending.push_back(std::move(work));
+		}
+		m_wake.notify_all();
+	}
+
+	// work posted while this runs waits for the next call
+	size_t run_pending()
+	{
+		std::vector<std::function<void()>> work;
+		{
+			std::scoped_lock a{m_mutex};
+			work.swap(m_pending);
+		}
+		for (auto &f : work)
+		{
+			f();
+		}
+		return work.size();
+	}
+
+	// sleeps until something is posted or until limit
+	void wait(clock::time_point limit)
+	{
+		std::unique_lock a{m_mutex};
+		m_wake.wait_until(a, limit, [&]() { return !m_pending.empty(); });
+	}
+
+	private:
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::vector<std::function<void()>> m_pending;
+};
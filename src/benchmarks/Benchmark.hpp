@@ -0,0 +1,66 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+// tiny stand-in for google benchmark, a benchmark body loops on
+// keep_running() and can report its own counters next to the timings
+class Benchmark
+{
+	public:
+	using function = std::function<void(Benchmark &)>;
+
+	static bool add(std::string name, function body)
+	{
+		registry().emplace_back(std::move(name), std::move(body));
+		return true;
+	}
+	static std::vector<std::pair<std::string, function>> &registry()
+	{
+		static std::vector<std::pair<std::string, function>> benchmarks;
+		return benchmarks;
+	}
+
+	bool keep_running()
+	{
+		auto now = std::chrono::steady_clock::now();
+		if (m_iterations == 0)
+		{
+			m_start = now;
+		}
+		else
+		{
+			m_elapsed = now - m_start;
+		}
+		if (m_iterations >= max_iterations
+		    || (m_iterations > 0 && m_elapsed >= min_time))
+		{
+			return false;
+		}
+		m_iterations++;
+		return true;
+	}
+
+	size_t iterations() const { return m_iterations; }
+	std::chrono::duration<double> elapsed() const { return m_elapsed; }
+
+	// counters are averaged over iterations when printed
+	std::map<std::string, double> counters;
+
+	std::chrono::duration<double> min_time{0.5};
+	size_t max_iterations = 1'000'000;
+
+	private:
+	size_t m_iterations = 0;
+	std::chrono::steady_clock::time_point m_start;
+	std::chrono::duration<double> m_elapsed{0};
+};
+
+#define BENCHMARK_CONCAT_IMPL(a, b) a##b
+#define BENCHMARK_CONCAT(a, b) BENCHMARK_CONCAT_IMPL(a, b)
+#define BENCHMARK(name, body)                                                  \
+	static bool BENCHMARK_CONCAT(benchmark_registered_, __LINE__)              \
+	    = Benchmark::add(name, body)
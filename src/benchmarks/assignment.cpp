@@ -0,0 +1,293 @@
+#include <algorithm>
+#include <deque>
+#include <limits>
+#include <optional>
+#include <random>
+
+#include "Benchmark.hpp"
+
+#include "Assignment.hpp"
+#include "TourPlanner.hpp"
+
+#include <glm/ext.hpp>
+
+// farmers looking after four fields of crops that ripen in waves. a step is
+// one turtle move (~0.4s), a turtle needs 10 steps at a plant to harvest it
+// and sweep up the drops, a harvested plant is ripe again 1500-3000 steps
+// later. the only difference between the runs is who picks which plant and
+// in what order
+namespace
+{
+constexpr int steps_per_hour = 9000;
+constexpr int harvest_steps = 10;
+// same as world.cpp
+constexpr size_t max_tour_stops = 16;
+
+struct Farm
+{
+	struct Crop
+	{
+		glm::ivec3 position;
+		int ripe_at;
+		bool taken = false;
+	};
+	struct Farmer
+	{
+		glm::ivec3 position;
+		std::optional<size_t> crop;
+		int busy_until = 0;
+		std::deque<size_t> tour;
+	};
+
+	std::vector<Crop> crops;
+	std::vector<Farmer> farmers;
+	std::mt19937 random{7};
+	double harvested = 0, travelled = 0;
+
+	explicit Farm(size_t farmer_count)
+	{
+		glm::ivec3 field_corners[]{
+		    {0, 0, 0},
+		    {60, 0, 0},
+		    {0, 0, 60},
+		    {60, 0, 60}};
+		std::uniform_int_distribution<int> first_ripe{0, 600};
+		for (auto corner : field_corners)
+		{
+			for (int x = 0; x < 20; x++)
+			{
+				for (int z = 0; z < 5; z++)
+				{
+					// a field is planted at once so it ripens at once
+					crops.push_back(
+					    {corner + glm::ivec3{x, 0, z * 2},
+					     first_ripe(random) / 200 * 200});
+				}
+			}
+		}
+		std::uniform_int_distribution<int> spot{0, 80};
+		for (size_t i = 0; i < farmer_count; i++)
+		{
+			farmers.push_back({{spot(random), 0, spot(random)}, {}, 0, {}});
+		}
+	}
+
+	static double distance(glm::ivec3 a, glm::ivec3 b)
+	{
+		return glm::distance(glm::dvec3{a}, glm::dvec3{b});
+	}
+
+	void send(size_t farmer, size_t crop, int now)
+	{
+		auto path = glm::abs(crops[crop].position - farmers[farmer].position);
+		int travel = path.x + path.y + path.z;
+		travelled += travel;
+		farmers[farmer].crop = crop;
+		farmers[farmer].busy_until = now + travel + harvest_steps;
+		crops[crop].taken = true;
+	}
+
+	void finish_work(int now)
+	{
+		std::uniform_int_distribution<int> regrow{1500, 3000};
+		for (auto &farmer : farmers)
+		{
+			if (farmer.crop && farmer.busy_until <= now)
+			{
+				auto &crop = crops[*farmer.crop];
+				farmer.position = crop.position;
+				crop.taken = false;
+				crop.ripe_at = now + regrow(random);
+				farmer.crop = std::nullopt;
+				harvested++;
+			}
+		}
+		for (size_t i = 0; i < farmers.size(); i++)
+		{
+			if (!farmers[i].crop && !farmers[i].tour.empty())
+			{
+				auto next = farmers[i].tour.front();
+				farmers[i].tour.pop_front();
+				send(i, next, now);
+			}
+		}
+	}
+
+	std::vector<size_t> due(int now)
+	{
+		std::vector<size_t> ripe;
+		for (size_t i = 0; i < crops.size(); i++)
+		{
+			if (!crops[i].taken && crops[i].ripe_at <= now)
+			{
+				ripe.push_back(i);
+			}
+		}
+		return ripe;
+	}
+
+	std::vector<size_t> idle()
+	{
+		std::vector<size_t> found;
+		for (size_t i = 0; i < farmers.size(); i++)
+		{
+			if (!farmers[i].crop)
+			{
+				found.push_back(i);
+			}
+		}
+		return found;
+	}
+};
+
+// every ripe plant grabs the closest idle farmer, in the order they come due
+void greedy(Farm &farm, int now)
+{
+	for (auto crop : farm.due(now))
+	{
+		auto idle = farm.idle();
+		if (idle.empty())
+		{
+			return;
+		}
+		auto closest = *std::min_element(
+		    idle.begin(),
+		    idle.end(),
+		    [&](size_t a, size_t b) {
+			    auto target = farm.crops[crop].position;
+			    return Farm::distance(farm.farmers[a].position, target)
+			           < Farm::distance(farm.farmers[b].position, target);
+		    });
+		farm.send(closest, crop, now);
+	}
+}
+
+void matched(Farm &farm, int now)
+{
+	auto due = farm.due(now);
+	auto idle = farm.idle();
+	if (due.empty() || idle.empty())
+	{
+		return;
+	}
+	std::vector<std::vector<double>> cost(
+	    due.size(),
+	    std::vector<double>(idle.size()));
+	for (size_t t = 0; t < due.size(); t++)
+	{
+		for (size_t i = 0; i < idle.size(); i++)
+		{
+			cost[t][i] = Farm::distance(
+			    farm.farmers[idle[i]].position,
+			    farm.crops[due[t]].position);
+		}
+	}
+	auto assignment = solve_assignment(cost);
+	for (size_t t = 0; t < due.size(); t++)
+	{
+		if (assignment[t])
+		{
+			farm.send(idle[*assignment[t]], due[t], now);
+		}
+	}
+}
+
+// matched, then the plants nobody got are grown onto the tours and every
+// tour is ordered by walking distance, like assign_due_blocks
+void toured(Farm &farm, int now)
+{
+	auto due = farm.due(now);
+	auto idle = farm.idle();
+	if (due.empty() || idle.empty())
+	{
+		return;
+	}
+	std::vector<std::vector<double>> cost(
+	    due.size(),
+	    std::vector<double>(idle.size()));
+	for (size_t t = 0; t < due.size(); t++)
+	{
+		for (size_t i = 0; i < idle.size(); i++)
+		{
+			cost[t][i] = Farm::distance(
+			    farm.farmers[idle[i]].position,
+			    farm.crops[due[t]].position);
+		}
+	}
+	auto assignment = solve_assignment(cost);
+	std::vector<std::vector<size_t>> tours(idle.size());
+	for (size_t t = 0; t < due.size(); t++)
+	{
+		if (assignment[t])
+		{
+			tours[*assignment[t]].push_back(due[t]);
+		}
+	}
+	std::vector<size_t> left_over;
+	for (size_t t = 0; t < due.size(); t++)
+	{
+		if (!assignment[t])
+		{
+			left_over.push_back(due[t]);
+		}
+	}
+	std::vector<glm::ivec3> positions;
+	for (auto &crop : farm.crops)
+	{
+		positions.push_back(crop.position);
+	}
+	grow_tours(positions, tours, left_over, max_tour_stops);
+	// the turtles walk on top of the field
+	auto off_the_field = [](glm::ivec3 position) { return position.y != 0; };
+	for (size_t i = 0; i < idle.size(); i++)
+	{
+		if (tours[i].empty())
+		{
+			continue;
+		}
+		auto &farmer = farm.farmers[idle[i]];
+		std::vector<glm::ivec3> points{farmer.position};
+		for (auto crop : tours[i])
+		{
+			points.push_back(farm.crops[crop].position);
+			farm.crops[crop].taken = true;
+		}
+		auto order = plan_tour(path_distances(points, off_the_field));
+		for (size_t stop = 1; stop < order.size(); stop++)
+		{
+			farmer.tour.push_back(tours[i][order[stop] - 1]);
+		}
+		farm.send(idle[i], tours[i][order[0] - 1], now);
+	}
+}
+
+void simulate(Benchmark &state, size_t farmers, void (*assign)(Farm &, int))
+{
+	double harvested = 0, travelled = 0;
+	while (state.keep_running())
+	{
+		Farm farm{farmers};
+		for (int now = 0; now < steps_per_hour; now++)
+		{
+			farm.finish_work(now);
+			assign(farm, now);
+		}
+		harvested += farm.harvested;
+		travelled += farm.travelled;
+	}
+	state.counters["crops_per_hour"] = harvested;
+	state.counters["travel_per_crop"]
+	    = travelled / std::max(harvested, 1.0) * state.iterations();
+}
+} // namespace
+
+BENCHMARK("assignment/greedy/4", [](Benchmark &s) { simulate(s, 4, greedy); });
+BENCHMARK("assignment/matched/4", [](Benchmark &s) { simulate(s, 4, matched); });
+BENCHMARK("assignment/toured/4", [](Benchmark &s) { simulate(s, 4, toured); });
+BENCHMARK("assignment/greedy/16", [](Benchmark &s) { simulate(s, 16, greedy); });
+BENCHMARK("assignment/matched/16", [](Benchmark &s) {
+	simulate(s, 16, matched);
+});
+BENCHMARK("assignment/toured/16", [](Benchmark &s) {
+	simulate(s, 16, toured);
+});
@@ -0,0 +1,34 @@
+#include <iomanip>
+#include <iostream>
+
+#include "Benchmark.hpp"
+
+int main(int argc, char **argv)
+{
+	std::string filter = argc > 1 ? argv[1] : "";
+	for (auto &[name, body] : Benchmark::registry())
+	{
+		if (name.find(filter) == std::string::npos)
+		{
+			continue;
+		}
+		Benchmark state;
+		body(state);
+		if (state.iterations() == 0)
+		{
+			// returned without running, it had nothing to measure
+			continue;
+		}
+		auto per_iteration = state.elapsed().count()
+		                     / std::max<size_t>(state.iterations(), 1);
+		std::cout << std::left << std::setw(48) << name << std::right
+		          << std::setw(12) << state.iterations() << std::setw(14)
+		          << std::setprecision(4) << per_iteration * 1e6 << " us";
+		for (auto &counter : state.counters)
+		{
+			std::cout << "  " << counter.first << '='
+			          << counter.second / std::max<size_t>(state.iterations(), 1);
+		}
+		std::cout << '\n';
+	}
+}
@@ -0,0 +1,206 @@
+#include <random>
+#include <unordered_set>
+
+#include "Benchmark.hpp"
+
+#include "AStar.hpp"
+#include "CooperativeAStar.hpp"
+#include "ReservationTable.hpp"
+
+// farmers on a flat field, every turtle gets a new random goal as soon as it
+// reaches its current one, throughput is goals reached per simulated step
+namespace
+{
+constexpr int field_size = 24;
+constexpr int simulated_steps = 200;
+
+bool field_obstacle(glm::ivec3 position)
+{
+	return position.y != 0 || position.x < 0 || position.z < 0
+	       || position.x >= field_size || position.z >= field_size;
+}
+
+struct Fleet
+{
+	std::vector<glm::ivec3> positions;
+	std::vector<glm::ivec3> goals;
+	std::mt19937 random{1234};
+
+	explicit Fleet(size_t turtles)
+	{
+		std::unordered_set<glm::ivec3> taken;
+		while (positions.size() < turtles)
+		{
+			auto position = random_cell();
+			if (taken.insert(position).second)
+			{
+				positions.push_back(position);
+			}
+		}
+		for (size_t i = 0; i < turtles; i++)
+		{
+			goals.push_back(random_cell());
+		}
+	}
+
+	glm::ivec3 random_cell()
+	{
+		std::uniform_int_distribution<int> cell{0, field_size - 1};
+		return glm::ivec3{cell(random), 0, cell(random)};
+	}
+
+	bool occupied(glm::ivec3 position, size_t except)
+	{
+		for (size_t i = 0; i < positions.size(); i++)
+		{
+			if (i != except && positions[i] == position)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+};
+
+// what the controller did before cooperative pathing, every turtle plans on
+// its own around the others' current positions and repaths on collision
+void independent_fleet(Benchmark &state, size_t turtles)
+{
+	double reached = 0, repaths = 0, stuck_steps = 0;
+	while (state.keep_running())
+	{
+		Fleet fleet{turtles};
+		std::vector<std::vector<glm::ivec3>> paths(turtles);
+		std::vector<size_t> progress(turtles, 0);
+		auto plan = [&](size_t i) {
+			AStar pather{fleet.positions[i], fleet.goals[i], [&, i](glm::ivec3 p) {
+				             return field_obstacle(p) || fleet.occupied(p, i);
+			             }};
+			paths[i].clear();
+			progress[i] = 0;
+			if (pather.run())
+			{
+				paths[i] = pather.path_result();
+			}
+		};
+		for (size_t i = 0; i < turtles; i++)
+		{
+			plan(i);
+		}
+		for (int step = 0; step < simulated_steps; step++)
+		{
+			for (size_t i = 0; i < turtles; i++)
+			{
+				if (fleet.positions[i] == fleet.goals[i])
+				{
+					reached++;
+					fleet.goals[i] = fleet.random_cell();
+					plan(i);
+					continue;
+				}
+				if (progress[i] + 1 >= paths[i].size())
+				{
+					stuck_steps++;
+					repaths++;
+					plan(i);
+					continue;
+				}
+				auto next = paths[i][progress[i] + 1];
+				if (fleet.occupied(next, i))
+				{
+					stuck_steps++;
+					repaths++;
+					plan(i);
+					continue;
+				}
+				fleet.positions[i] = next;
+				progress[i]++;
+			}
+		}
+	}
+	state.counters["goals_per_100_steps"] = reached * 100 / simulated_steps;
+	state.counters["repaths"] = repaths;
+	state.counters["stuck_steps"] = stuck_steps;
+}
+
+// windowed cooperative planning the way the world does it, every turtle
+// plans against the reservations of the ones that planned before it. the
+// whole fleet is replanned every half window like WHCA* does and moves in
+// lockstep along the reserved paths
+void cooperative_fleet(Benchmark &state, size_t turtles)
+{
+	constexpr int window = CooperativeAStar::default_window;
+	double reached = 0, unplanned = 0, waits = 0;
+	while (state.keep_running())
+	{
+		Fleet fleet{turtles};
+		for (int step = 0; step < simulated_steps; step += window / 2)
+		{
+			ReservationTable reservations;
+			for (size_t i = 0; i < turtles; i++)
+			{
+				reservations.rest(std::to_string(i), fleet.positions[i], 0);
+			}
+			std::vector<std::vector<glm::ivec3>> paths(turtles);
+			for (size_t i = 0; i < turtles; i++)
+			{
+				CooperativeAStar pather{
+				    fleet.positions[i],
+				    fleet.goals[i],
+				    field_obstacle,
+				    reservations,
+				    std::to_string(i),
+				    window};
+				if (pather.run())
+				{
+					paths[i] = pather.path_result();
+				}
+				else
+				{
+					unplanned++;
+				}
+			}
+			for (int substep = 1; substep <= window / 2; substep++)
+			{
+				for (size_t i = 0; i < turtles; i++)
+				{
+					auto &path = paths[i];
+					if (path.empty())
+					{
+						waits++;
+						continue;
+					}
+					auto next = path[std::min<size_t>(substep, path.size() - 1)];
+					if (next == fleet.positions[i])
+					{
+						waits++;
+					}
+					fleet.positions[i] = next;
+				}
+				for (size_t i = 0; i < turtles; i++)
+				{
+					if (fleet.positions[i] == fleet.goals[i])
+					{
+						reached++;
+						fleet.goals[i] = fleet.random_cell();
+					}
+				}
+			}
+		}
+	}
+	state.counters["goals_per_100_steps"] = reached * 100 / simulated_steps;
+	state.counters["unplanned"] = unplanned;
+	state.counters["waits"] = waits;
+}
+} // namespace
+
+BENCHMARK("fleet/independent/10", [](Benchmark &s) { independent_fleet(s, 10); });
+BENCHMARK("fleet/independent/50", [](Benchmark &s) { independent_fleet(s, 50); });
+BENCHMARK("fleet/independent/100", [](Benchmark &s) {
+	independent_fleet(s, 100);
+});
+BENCHMARK("fleet/cooperative/10", [](Benchmark &s) { cooperative_fleet(s, 10); });
+BENCHMARK("fleet/cooperative/50", [](Benchmark &s) { cooperative_fleet(s, 50); });
+BENCHMARK("fleet/cooperative/100", [](Benchmark &s) {
+	cooperative_fleet(s, 100);
+});
@@ -0,0 +1,58 @@
+#include <random>
+
+#include "Benchmark.hpp"
+
+#include "SelectBlock.hpp"
+
+// what the mouse is over, looking at a 64x64 field of blocks 4 deep with a
+// few turtles on it from above at an angle, like the camera usually does
+namespace
+{
+RenderScene field_scene()
+{
+	RenderScene scene;
+	scene.view.server = "bench";
+	scene.view.dimension = "overworld";
+	for (int x = 0; x < 64; x++)
+	{
+		for (int z = 0; z < 64; z++)
+		{
+			for (int y = 0; y < 4; y++)
+			{
+				scene.block_positions.emplace_back(x, y, z, 0);
+			}
+		}
+	}
+	for (int i = 0; i < 64; i++)
+	{
+		scene.turtles.push_back(
+		    {"bench", "overworld", {i, 4, (i * 7) % 64}, north});
+	}
+	return scene;
+}
+
+void pick(Benchmark &state)
+{
+	auto scene = field_scene();
+	std::mt19937 random{3};
+	std::uniform_real_distribution<double> spread{-0.4, 0.4};
+	std::vector<RayInfo> rays;
+	for (int i = 0; i < 64; i++)
+	{
+		rays.emplace_back(
+		    glm::dvec3{32, 40, 90},
+		    glm::dvec3{spread(random), -0.6 + spread(random), -1});
+	}
+	double hits = 0;
+	while (state.keep_running())
+	{
+		for (auto &ray : rays)
+		{
+			hits += find_selected(ray, scene).index() != 0;
+		}
+	}
+	state.counters["hits"] = hits;
+}
+} // namespace
+
+BENCHMARK("picking/find_selected", pick);
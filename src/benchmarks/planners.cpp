@@ -0,0 +1,264 @@
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+
+#include "Benchmark.hpp"
+
+#include "world.hpp"
+
+// the single agent planners side by side, on made up scenes and on routes
+// between blocks of a saved world (BENCHMARK_WORLD, default
+// world_default.save in the working directory)
+namespace
+{
+struct Route
+{
+	glm::ivec3 start, goal;
+	std::function<bool(glm::ivec3)> obstacle;
+};
+
+std::unique_ptr<Planner> make_planner(
+    PlannerKind kind,
+    glm::ivec3 start,
+    glm::ivec3 goal,
+    std::function<bool(glm::ivec3)> obstacle)
+{
+	switch (kind)
+	{
+	case PlannerKind::bidirectional:
+		return std::make_unique<BidirectionalAStar>(start, goal, obstacle);
+	case PlannerKind::jump_point:
+		return std::make_unique<JumpPointSearch>(start, goal, obstacle);
+	default:
+		return std::make_unique<AStar>(start, goal, obstacle);
+	}
+}
+
+void run_routes(Benchmark &state, PlannerKind kind, std::vector<Route> &routes)
+{
+	if (routes.empty())
+	{
+		// nothing to time, the case doesn't get a row
+		return;
+	}
+	double found = 0, path_length = 0, obstacle_checks = 0, expanded = 0;
+	while (state.keep_running())
+	{
+		for (auto &route : routes)
+		{
+			auto counted = [&](glm::ivec3 position) {
+				obstacle_checks++;
+				return route.obstacle(position);
+			};
+			auto planner = make_planner(kind, route.start, route.goal, counted);
+			if (planner->run())
+			{
+				found++;
+				path_length += planner->path_result().size();
+			}
+			expanded += planner->expanded_nodes;
+		}
+	}
+	state.counters["found"] = found;
+	state.counters["path_length"] = path_length;
+	state.counters["obstacle_checks"] = obstacle_checks;
+	state.counters["expanded"] = expanded;
+}
+
+std::vector<Route> &open_air()
+{
+	static std::vector<Route> routes{
+	    {{0, 64, 0}, {120, 80, -90}, [](glm::ivec3 p) { return p.y < 0; }}};
+	return routes;
+}
+
+// a wall in the way with one hole in it, off to the side
+std::vector<Route> &wall()
+{
+	static std::vector<Route> routes{
+	    {{0, 0, 0}, {40, 0, 0}, [](glm::ivec3 p) {
+		     bool hole = p.y == 2 && p.z == 25;
+		     return p.y < 0 || (p.x == 20 && p.y < 30 && !hole);
+	     }}};
+	return routes;
+}
+
+// a 32 block cube of 30% stone with random routes through it
+std::vector<Route> &cave()
+{
+	static std::vector<Route> routes = [] {
+		constexpr int size = 32;
+		auto stone = std::make_shared<std::unordered_set<glm::ivec3>>();
+		std::mt19937 random{42};
+		std::uniform_int_distribution<int> cell{0, size - 1};
+		for (int i = 0; i < size * size * size * 3 / 10; i++)
+		{
+			stone->insert({cell(random), cell(random), cell(random)});
+		}
+		auto obstacle = [stone](glm::ivec3 p) {
+			return p.x < 0 || p.y < 0 || p.z < 0 || p.x >= size || p.y >= size
+			       || p.z >= size || stone->contains(p);
+		};
+		std::vector<Route> routes;
+		while (routes.size() < 16)
+		{
+			glm::ivec3 start{cell(random), cell(random), cell(random)};
+			glm::ivec3 goal{cell(random), cell(random), cell(random)};
+			if (!obstacle(start) && !obstacle(goal))
+			{
+				routes.push_back({start, goal, obstacle});
+			}
+		}
+		return routes;
+	}();
+	return routes;
+}
+
+// a 63x63 maze one block high with a single way between any two cells, from
+// corner to corner and between random cells
+std::vector<Route> &maze()
+{
+	static std::vector<Route> routes = [] {
+		constexpr int size = 63;
+		auto open = std::make_shared<std::unordered_set<glm::ivec3>>();
+		std::mt19937 random{42};
+		// depth first carving between the odd cells
+		std::vector<glm::ivec3> stack{{1, 0, 1}};
+		open->insert(stack.back());
+		while (!stack.empty())
+		{
+			auto cell = stack.back();
+			glm::ivec3 steps[]{{2, 0, 0}, {-2, 0, 0}, {0, 0, 2}, {0, 0, -2}};
+			std::shuffle(std::begin(steps), std::end(steps), random);
+			bool carved = false;
+			for (auto step : steps)
+			{
+				auto next = cell + step;
+				if (next.x > 0 && next.z > 0 && next.x < size - 1
+				    && next.z < size - 1 && !open->contains(next))
+				{
+					open->insert(cell + step / 2);
+					open->insert(next);
+					stack.push_back(next);
+					carved = true;
+					break;
+				}
+			}
+			if (!carved)
+			{
+				stack.pop_back();
+			}
+		}
+		auto obstacle
+		    = [open](glm::ivec3 p) { return p.y != 0 || !open->contains(p); };
+		std::vector<Route> routes{
+		    {{1, 0, 1}, {size - 2, 0, size - 2}, obstacle}};
+		std::uniform_int_distribution<int> cell{0, size / 2 - 1};
+		while (routes.size() < 8)
+		{
+			glm::ivec3 start{cell(random) * 2 + 1, 0, cell(random) * 2 + 1};
+			glm::ivec3 goal{cell(random) * 2 + 1, 0, cell(random) * 2 + 1};
+			routes.push_back({start, goal, obstacle});
+		}
+		return routes;
+	}();
+	return routes;
+}
+
+std::string saved_world_path()
+{
+	auto path = std::getenv("BENCHMARK_WORLD");
+	return path ? path : "world_default.save";
+}
+
+// routes from every saved turtle to the tops of blocks around it, using the
+// obstacle function a real Pathing would get
+std::vector<Route> &saved_world()
+{
+	static World world;
+	static std::vector<Route> routes = [] {
+		std::vector<Route> routes;
+		std::fstream save{saved_world_path(), std::ios::in};
+		if (!save.is_open())
+		{
+			return routes;
+		}
+		boost::archive::text_iarchive ar{save};
+		ar >> world;
+		std::mt19937 random{42};
+		for (auto &turtle : world.m_turtles)
+		{
+			auto &blocks = world.m_blocks[turtle.position.server]
+			                             [turtle.position.dimension];
+			std::vector<glm::ivec3> tops;
+			for (auto &x : blocks)
+			{
+				for (auto &y : x.second)
+				{
+					for (auto &z : y.second)
+					{
+						glm::ivec3 top{x.first, y.first + 1, z.first};
+						auto distance = glm::abs(top - turtle.position.position);
+						if (distance.x + distance.y + distance.z < 128)
+						{
+							tops.push_back(top);
+						}
+					}
+				}
+			}
+			if (tops.empty())
+			{
+				continue;
+			}
+			auto obstacle
+			    = world.make_obstacle_function(ObstacleKind::normal, turtle, false);
+			std::uniform_int_distribution<size_t> pick{0, tops.size() - 1};
+			for (int i = 0; i < 8; i++)
+			{
+				auto goal = tops[pick(random)];
+				if (!obstacle(goal))
+				{
+					routes.push_back({turtle.position.position, goal, obstacle});
+				}
+			}
+		}
+		return routes;
+	}();
+	return routes;
+}
+
+void register_scene(std::string scene, std::vector<Route> &(*routes)())
+{
+	std::pair<std::string, PlannerKind> kinds[]{
+	    {"astar", PlannerKind::astar},
+	    {"bidirectional", PlannerKind::bidirectional},
+	    {"jump_point", PlannerKind::jump_point}};
+	for (auto &[name, kind] : kinds)
+	{
+		Benchmark::add(
+		    "planners/" + scene + "/" + name,
+		    [kind = kind, routes](Benchmark &state) {
+			    run_routes(state, kind, routes());
+		    });
+	}
+}
+
+bool registered = [] {
+	register_scene("open_air", open_air);
+	register_scene("wall", wall);
+	register_scene("cave", cave);
+	register_scene("maze", maze);
+	if (std::fstream{saved_world_path(), std::ios::in}.is_open())
+	{
+		register_scene("saved_world", saved_world);
+	}
+	else
+	{
+		std::cout << "no saved world to benchmark on\n";
+	}
+	return true;
+}();
+} // namespace
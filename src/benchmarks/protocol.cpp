@@ -0,0 +1,165 @@
+#include "Benchmark.hpp"
+
+#include "world.hpp"
+
+// building the requests sent to turtles: a route of the length pathing sends
+// as one buffer, turned into its request and into the text that goes over
+// the websocket
+namespace
+{
+CommandBuffer<nlohmann::json> route()
+{
+	CommandBuffer<nlohmann::json> buffer;
+	buffer.abort_on_failure();
+	for (size_t i = 0; i < World::max_route_length; i++)
+	{
+		if (i % 4 == 3)
+		{
+			buffer.rotate("right");
+		}
+		buffer.move("forward");
+	}
+	return buffer;
+}
+
+void build(Benchmark &state)
+{
+	double commands = 0;
+	while (state.keep_running())
+	{
+		commands += route().size();
+	}
+	state.counters["commands"] = commands;
+}
+
+void to_json(Benchmark &state)
+{
+	auto buffer = route();
+	while (state.keep_running())
+	{
+		auto request = ComputerInterface::make_command_buffer_json(buffer);
+		request["request_id"] = 1;
+	}
+}
+
+void to_text(Benchmark &state)
+{
+	auto buffer = route();
+	double bytes = 0;
+	while (state.keep_running())
+	{
+		auto request = ComputerInterface::make_command_buffer_json(buffer);
+		request["request_id"] = 1;
+		bytes += request.dump().size();
+	}
+	state.counters["bytes"] = bytes;
+}
+
+// a full inventory reply, slot 1 is the first item. slots counts the ones
+// parsed and has to come out as 16, first_slot the count in slot 1
+void parse_inventory(Benchmark &state)
+{
+	auto items = nlohmann::json::array();
+	for (int slot = 1; slot <= 16; slot++)
+	{
+		items.push_back(
+		    {{"name", "minecraft:wheat_seeds"}, {"count", slot}, {"damage", 0}});
+	}
+	double slots = 0, first_slot = 0;
+	while (state.keep_running())
+	{
+		auto inventory = World::inventory_from_JSON(items);
+		for (auto &item : inventory)
+		{
+			slots += item.has_value();
+		}
+		first_slot += inventory[0] ? inventory[0]->amount : 0;
+	}
+	state.counters["slots"] = slots;
+	state.counters["first_slot"] = first_slot;
+}
+
+// the same eval to a fleet, each turtle sent a request of its own that is
+// dumped for it or all of them one broadcast dumped once. a command buffer
+// isn't compared, execute_buffer already shares its text between turtles.
+// the fleet is connected anew every time so the unanswered requests don't
+// pile up
+constexpr size_t fleet_size = 200;
+
+// about as long as the route as text
+std::string script()
+{
+	std::string script;
+	for (size_t i = 0; i < World::max_route_length; i++)
+	{
+		script += "position.forward() position.turnRight() ";
+	}
+	return script;
+}
+
+server_manager &fleet_server()
+{
+	static server_manager s;
+	return s;
+}
+
+std::vector<std::shared_ptr<ComputerInterface>> connect_fleet()
+{
+	static std::vector<std::shared_ptr<int>> handles = [] {
+		std::vector<std::shared_ptr<int>> handles;
+		for (size_t i = 0; i < fleet_size; i++)
+		{
+			handles.push_back(std::make_shared<int>(i));
+		}
+		return handles;
+	}();
+	auto &s = fleet_server();
+	std::scoped_lock a{s.m_computers_mutex};
+	s.m_computers.clear();
+	std::vector<std::shared_ptr<ComputerInterface>> fleet;
+	for (auto &handle : handles)
+	{
+		fleet.push_back(std::make_shared<ComputerInterface>(
+		    websocketpp::connection_hdl{handle},
+		    s.m_endpoint));
+		s.m_computers.emplace(websocketpp::connection_hdl{handle}, fleet.back());
+	}
+	return fleet;
+}
+
+void send_each(Benchmark &state)
+{
+	auto to_eval = script();
+	while (state.keep_running())
+	{
+		auto fleet = connect_fleet();
+		for (auto &computer : fleet)
+		{
+			computer->remote_eval(to_eval);
+			computer->send_next_request();
+		}
+	}
+}
+
+void send_broadcast(Benchmark &state)
+{
+	auto to_eval = script();
+	while (state.keep_running())
+	{
+		auto fleet = connect_fleet();
+		auto replies = fleet_server().broadcast(
+		    {{"request_type", "eval"}, {"to_eval", to_eval}});
+		for (auto &computer : fleet)
+		{
+			computer->send_next_request();
+		}
+	}
+}
+} // namespace
+
+BENCHMARK("protocol/route/build", build);
+BENCHMARK("protocol/route/make_command_buffer_json", to_json);
+BENCHMARK("protocol/route/dump", to_text);
+BENCHMARK("protocol/inventory/parse", parse_inventory);
+BENCHMARK("protocol/fleet/each", send_each);
+BENCHMARK("protocol/fleet/broadcast", send_broadcast);
@@ -0,0 +1,102 @@
+#include <iostream>
+#include <streambuf>
+
+#include "Benchmark.hpp"
+
+#include "RenderSnapshot.hpp"
+#include "TrafficReplay.hpp"
+
+// a block scan flood as it comes off the wire, every turtle pushing the 3x3x3
+// around it. an iteration replays one scan from every turtle into a world
+// that already has them, parsing and updating the world, optionally with the
+// renderer's copy of the world made after every frame like the engine does
+// after a tick. real captures replay through controller_headless --replay
+namespace
+{
+constexpr uint32_t scanning_turtles = 100;
+
+std::vector<TrafficFrame> scan_flood()
+{
+	std::vector<TrafficFrame> frames;
+	for (uint32_t turtle = 1; turtle <= scanning_turtles; turtle++)
+	{
+		auto blocks = nlohmann::json::array();
+		for (int x = -1; x <= 1; x++)
+		{
+			for (int y = -1; y <= 1; y++)
+			{
+				for (int z = -1; z <= 1; z++)
+				{
+					nlohmann::json block{
+					    {"position",
+					     {static_cast<int>(turtle) * 4 + x, 64 + y, z}},
+					    {"dimension", "overworld"},
+					    {"server", "replay"},
+					    {"found_block", y < 0}};
+					if (y < 0)
+					{
+						block["block"]
+						    = {{"name", "minecraft:stone"},
+						       {"metadata", 0},
+						       {"state", nlohmann::json::object()}};
+					}
+					blocks.push_back(std::move(block));
+				}
+			}
+		}
+		frames.push_back(
+		    {0,
+		     turtle,
+		     TrafficFrame::inbound,
+		     nlohmann::json{{"request_id", -1}, {"response", blocks}}.dump()});
+	}
+	return frames;
+}
+
+// ComputerInterface prints everything a turtle sends
+struct NullBuffer : std::streambuf
+{
+	int overflow(int c) override { return c; }
+	std::streamsize xsputn(const char *, std::streamsize n) override
+	{
+		return n;
+	}
+};
+
+void replay_flood(Benchmark &state, bool snapshots)
+{
+	NullBuffer null_buffer;
+	auto cout_buffer = std::cout.rdbuf(&null_buffer);
+
+	World world;
+	RenderSnapshots render;
+	TrafficReplay replay{world};
+	if (snapshots)
+	{
+		world.dirty_renderer = [&render]() { render.dirty(); };
+		replay.after_frame = [&render](World &world) { render.publish(world); };
+	}
+	for (uint32_t turtle = 1; turtle <= scanning_turtles; turtle++)
+	{
+		replay.play({0, turtle, TrafficFrame::opened, {}});
+	}
+	auto flood = scan_flood();
+	double bytes = 0;
+	while (state.keep_running())
+	{
+		for (auto &frame : flood)
+		{
+			replay.play(frame);
+			bytes += frame.payload.size();
+		}
+	}
+	state.counters["bytes"] = bytes;
+
+	std::cout.rdbuf(cout_buffer);
+}
+} // namespace
+
+BENCHMARK("replay/scan_flood", [](Benchmark &s) { replay_flood(s, false); });
+BENCHMARK("replay/scan_flood/snapshots", [](Benchmark &s) {
+	replay_flood(s, true);
+});
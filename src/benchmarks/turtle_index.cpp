@@ -0,0 +1,111 @@
+#include <map>
+#include <random>
+
+#include "Benchmark.hpp"
+
+#include "TurtleIndex.hpp"
+
+// nearest idle farmer for every candidate block, the way the automation
+// thread asks for them. half the turtles are busy and a third aren't farmers
+namespace
+{
+constexpr size_t turtle_count = 500;
+constexpr size_t block_count = 50'000;
+
+struct FakeTurtle
+{
+	glm::ivec3 position;
+	bool farmer;
+	bool idle;
+};
+
+struct Scene
+{
+	std::vector<FakeTurtle> turtles;
+	std::vector<glm::ivec3> blocks;
+
+	explicit Scene(int spread)
+	{
+		std::mt19937 random{99};
+		std::uniform_int_distribution<int> horizontal{-spread, spread};
+		std::uniform_int_distribution<int> vertical{50, 90};
+		for (size_t i = 0; i < turtle_count; i++)
+		{
+			turtles.push_back(
+			    {{horizontal(random), vertical(random), horizontal(random)},
+			     i % 3 != 0,
+			     i % 2 == 0});
+		}
+		for (size_t i = 0; i < block_count; i++)
+		{
+			blocks.push_back(
+			    {horizontal(random), vertical(random), horizontal(random)});
+		}
+	}
+
+	bool wanted(size_t i) const { return turtles[i].farmer && turtles[i].idle; }
+};
+
+// what find_closest_turtle did before the index
+void multimap_per_query(Benchmark &state, int spread)
+{
+	Scene scene{spread};
+	double found = 0;
+	while (state.keep_running())
+	{
+		for (auto &block : scene.blocks)
+		{
+			std::multimap<double, size_t> turtles;
+			for (size_t i = 0; i < scene.turtles.size(); i++)
+			{
+				if (scene.wanted(i))
+				{
+					turtles.emplace(
+					    glm::distance(
+					        glm::dvec3{scene.turtles[i].position},
+					        glm::dvec3{block}),
+					    i);
+				}
+			}
+			found += !turtles.empty();
+		}
+	}
+	state.counters["found"] = found;
+}
+
+void grid_index(Benchmark &state, int spread)
+{
+	Scene scene{spread};
+	TurtleIndex index;
+	for (size_t i = 0; i < scene.turtles.size(); i++)
+	{
+		index.update(i, "server", "overworld", scene.turtles[i].position);
+	}
+	double found = 0;
+	while (state.keep_running())
+	{
+		for (auto &block : scene.blocks)
+		{
+			found += index
+			             .nearest(
+			                 "server",
+			                 "overworld",
+			                 block,
+			                 [&](size_t i) { return scene.wanted(i); })
+			             .has_value();
+		}
+	}
+	state.counters["found"] = found;
+}
+} // namespace
+
+BENCHMARK("closest_turtle/multimap/farm", [](Benchmark &s) {
+	multimap_per_query(s, 256);
+});
+BENCHMARK("closest_turtle/grid/farm", [](Benchmark &s) { grid_index(s, 256); });
+BENCHMARK("closest_turtle/multimap/spread_out", [](Benchmark &s) {
+	multimap_per_query(s, 4096);
+});
+BENCHMARK("closest_turtle/grid/spread_out", [](Benchmark &s) {
+	grid_index(s, 4096);
+});
@@ -0,0 +1,195 @@
+#include <random>
+#include <sstream>
+
+#include "Benchmark.hpp"
+
+#include "world.hpp"
+
+// the world's own data on a made up area: 64x64 columns 8 blocks deep with a
+// scattering of turtles on top, looked up, updated from turtle pushes and
+// saved and loaded the way the controller does it
+namespace
+{
+constexpr int area_size = 64;
+constexpr int area_depth = 8;
+constexpr int area_turtles = 200;
+
+nlohmann::json block_json(glm::ivec3 position, std::string name, int age)
+{
+	return {
+	    {"position", {position.x, position.y, position.z}},
+	    {"dimension", "overworld"},
+	    {"server", "bench"},
+	    {"found_block", true},
+	    {"block",
+	     {{"name", std::move(name)},
+	      {"metadata", 0},
+	      {"state", {{"age", age}}}}}};
+}
+
+// never listens, the turtles only need a connection to be handed work
+std::shared_ptr<ComputerInterface> unconnected_computer()
+{
+	static server endpoint;
+	static std::vector<std::shared_ptr<ComputerInterface>> computers;
+	computers.push_back(std::make_shared<ComputerInterface>(
+	    websocketpp::connection_hdl{},
+	    endpoint));
+	return computers.back();
+}
+
+void fill(World &world)
+{
+	auto blocks = nlohmann::json::array();
+	for (int x = 0; x < area_size; x++)
+	{
+		for (int z = 0; z < area_size; z++)
+		{
+			for (int y = 0; y < area_depth; y++)
+			{
+				blocks.push_back(block_json({x, y, z}, "minecraft:stone", 0));
+			}
+		}
+	}
+	world.update_block_from_JSON(blocks);
+	std::mt19937 random{7};
+	std::uniform_int_distribution<int> cell{0, area_size - 1};
+	for (int i = 0; i < area_turtles; i++)
+	{
+		Turtle turtle;
+		turtle.name = std::to_string(i);
+		turtle.position = {
+		    "bench",
+		    "overworld",
+		    {cell(random), area_depth, cell(random)},
+		    north};
+		turtle.value.job = TurtleValue::FARMER;
+		turtle.connection = unconnected_computer();
+		world.m_turtles.push_back(std::move(turtle));
+	}
+	world.reindex_turtles();
+}
+
+World &filled_world()
+{
+	static World world;
+	[[maybe_unused]] static bool filled = [] {
+		fill(world);
+		return true;
+	}();
+	return world;
+}
+
+std::vector<glm::ivec3> random_positions(size_t count, int margin)
+{
+	std::mt19937 random{11};
+	std::uniform_int_distribution<int> cell{-margin, area_size + margin};
+	std::uniform_int_distribution<int> height{-2, area_depth + 2};
+	std::vector<glm::ivec3> positions;
+	for (size_t i = 0; i < count; i++)
+	{
+		positions.emplace_back(cell(random), height(random), cell(random));
+	}
+	return positions;
+}
+
+void block_lookups(Benchmark &state)
+{
+	auto &world = filled_world();
+	auto positions = random_positions(1024, 8);
+	double found = 0;
+	while (state.keep_running())
+	{
+		for (auto &position : positions)
+		{
+			found += world.block_at("bench", "overworld", position).has_value();
+		}
+	}
+	state.counters["found"] = found;
+}
+
+// a turtle's scan of the 3x3x3 around it, with the crop in the middle a
+// stage older every time so the update isn't a no op
+void scan_updates(Benchmark &state)
+{
+	auto &world = filled_world();
+	auto scan = nlohmann::json::array();
+	for (int x = -1; x <= 1; x++)
+	{
+		for (int y = -1; y <= 1; y++)
+		{
+			for (int z = -1; z <= 1; z++)
+			{
+				scan.push_back(block_json(
+				    glm::ivec3{20 + x, area_depth + y, 20 + z},
+				    y < 0 ? "minecraft:stone" : "minecraft:wheat",
+				    0));
+			}
+		}
+	}
+	int age = 0;
+	while (state.keep_running())
+	{
+		scan[13]["block"]["state"]["age"] = age++ % 8;
+		world.update_block_from_JSON(scan);
+	}
+}
+
+void closest_turtle(Benchmark &state)
+{
+	auto &world = filled_world();
+	auto positions = random_positions(256, 0);
+	double found = 0;
+	while (state.keep_running())
+	{
+		for (auto &position : positions)
+		{
+			found += find_closest_turtle(
+			             position,
+			             TurtleValue::FARMER,
+			             world,
+			             "bench",
+			             "overworld")
+			             .has_value();
+		}
+	}
+	state.counters["found"] = found;
+}
+
+void save_world(Benchmark &state)
+{
+	auto &world = filled_world();
+	double bytes = 0;
+	while (state.keep_running())
+	{
+		std::stringstream save;
+		boost::archive::text_oarchive ar{save};
+		ar << world;
+		bytes += save.tellp();
+	}
+	state.counters["bytes"] = bytes;
+}
+
+void load_world(Benchmark &state)
+{
+	std::stringstream save;
+	{
+		boost::archive::text_oarchive ar{save};
+		ar << filled_world();
+	}
+	auto saved = save.str();
+	while (state.keep_running())
+	{
+		std::stringstream load{saved};
+		boost::archive::text_iarchive ar{load};
+		World world;
+		ar >> world;
+	}
+}
+} // namespace
+
+BENCHMARK("world/block_at", block_lookups);
+BENCHMARK("world/update_block_from_JSON/scan", scan_updates);
+BENCHMARK("world/find_closest_turtle", closest_turtle);
+BENCHMARK("world/serialize/save", save_world);
+BENCHMARK("world/serialize/load", load_world);
@@ -0,0 +1,209 @@
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "AutomationEngine.hpp"
+#include "Computer.hpp"
+#include "Metrics.hpp"
+#include "Server.hpp"
+#include "Trace.hpp"
+#include "TrafficReplay.hpp"
+#include "world.hpp"
+
+// the controller without a window, for machines that have no display. the
+// world is driven by the automation engine alone, changing what the turtles
+// do still needs the gui build on the same save
+
+namespace
+{
+volatile std::sig_atomic_t stop_requested = 0;
+volatile std::sig_atomic_t trace_requested = 0;
+
+void request_stop(int) { stop_requested = 1; }
+void request_trace(int) { trace_requested = 1; }
+
+void print_usage(const char *name)
+{
+	std::cerr << "usage: " << name
+	          << " [--tick-ms n] [--save path] [--record path]"
+	             " [--replay path [--replay-fast]] [--trace path]\n"
+	          << "  --tick-ms      how often turtles are looked at when nothing"
+	             " else wakes the automation (default "
+	          << AutomationEngine::default_poll_interval.count() << ")\n"
+	          << "  --save         world save to load and autosave to (default"
+	             " world_default.save)\n"
+	          << "  --record       write all turtle traffic to a capture\n"
+	          << "  --replay       feed a capture to the loaded save instead of"
+	             " listening, at the speed it was recorded. the save isn't"
+	             " written\n"
+	          << "  --replay-fast  replay as fast as the world takes it\n"
+	          << "  --trace        record where time goes and write it as a"
+	             " chrome trace on SIGUSR1 and when stopping, each write has"
+	             " what came after the last one\n";
+}
+
+// nothing if tracing wasn't asked for
+void write_trace(const std::string &path)
+{
+	if (!path.empty() && !tracer().write(path))
+	{
+		std::cerr << "can't write the trace to " << path << '\n';
+	}
+}
+
+void save(World &world, const std::string &path)
+{
+	WorldLock lock{world.world_mutex};
+	std::fstream save_file{path, std::ios::out | std::ios::trunc};
+	boost::archive::text_oarchive ar{save_file};
+	ar << world;
+}
+
+int replay(World &world, const std::string &path, bool fast)
+{
+	TrafficLog log{path};
+	if (!log.valid())
+	{
+		std::cerr << path << " isn't a capture\n";
+		return 1;
+	}
+	TrafficReplay replay{world};
+	auto totals = replay.replay(log, !fast);
+	std::cerr << "replayed " << totals.frames << " frames, "
+	          << totals.inbound_bytes << " bytes from turtles in "
+	          << totals.elapsed.count() << "s, "
+	          << totals.frames / totals.elapsed.count() << " frames/s\n";
+	return 0;
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+	std::chrono::milliseconds tick{AutomationEngine::default_poll_interval};
+	std::string save_path = "world_default.save";
+	std::string record_path;
+	std::string replay_path;
+	std::string trace_path;
+	bool replay_fast = false;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "--tick-ms" && i + 1 < argc)
+		{
+			tick = std::chrono::milliseconds{std::atol(argv[++i])};
+			if (tick.count() <= 0)
+			{
+				std::cerr << "--tick-ms has to be above 0\n";
+				return 1;
+			}
+		}
+		else if (argument == "--save" && i + 1 < argc)
+		{
+			save_path = argv[++i];
+		}
+		else if (argument == "--record" && i + 1 < argc)
+		{
+			record_path = argv[++i];
+		}
+		else if (argument == "--replay" && i + 1 < argc)
+		{
+			replay_path = argv[++i];
+		}
+		else if (argument == "--replay-fast")
+		{
+			replay_fast = true;
+		}
+		else if (argument == "--trace" && i + 1 < argc)
+		{
+			trace_path = argv[++i];
+		}
+		else
+		{
+			print_usage(argv[0]);
+			return argument == "--help" ? 0 : 1;
+		}
+	}
+
+	World world;
+	{
+		std::fstream default_save{save_path, std::ios::in};
+		if (default_save.is_open())
+		{
+			boost::archive::text_iarchive ar{default_save};
+			ar >> world;
+		}
+	}
+	if (!trace_path.empty())
+	{
+		tracer().name_thread("main");
+		tracer().start();
+	}
+	if (!replay_path.empty())
+	{
+		auto result = replay(world, replay_path, replay_fast);
+		write_trace(trace_path);
+		return result;
+	}
+
+	server_manager s;
+	s.register_new_handler(
+	    std::bind(&World::new_turtle, &world, std::placeholders::_1));
+	if (!record_path.empty() && !s.record_to(record_path))
+	{
+		std::cerr << "can't write to " << record_path << '\n';
+		return 1;
+	}
+
+	std::signal(SIGINT, request_stop);
+	std::signal(SIGTERM, request_stop);
+	std::signal(SIGUSR1, request_trace);
+
+	auto run_result = std::async(&server_manager::run, &s);
+	auto scheduler = std::async(&server_manager::scheduler, &s);
+	AutomationEngine automation{world, tick};
+	automation.start();
+	std::cout << "running headless, saving to " << save_path << '\n';
+
+	constexpr std::chrono::seconds autosave_interval{150};
+	auto last_save = std::chrono::steady_clock::now();
+	while (!stop_requested)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds{200});
+		if (trace_requested)
+		{
+			trace_requested = 0;
+			write_trace(trace_path);
+		}
+		auto now = std::chrono::steady_clock::now();
+		if (now - last_save > autosave_interval)
+		{
+			save(world, save_path);
+			last_save = now;
+			std::chrono::duration<double> took
+			    = std::chrono::steady_clock::now() - now;
+			metrics()
+			    .histogram(
+			        "controller_autosave_seconds",
+			        "how long an autosave took, waiting for the world included")
+			    .observe(took.count());
+			std::cout << "autosave\n";
+		}
+	}
+
+	std::cout << "stopping\n";
+	automation.stop();
+	save(world, save_path);
+	write_trace(trace_path);
+
+	s.scheduler_stop = true;
+	scheduler.wait();
+	s.send_stops();
+	std::this_thread::sleep_for(std::chrono::seconds{1});
+	s.stop();
+}
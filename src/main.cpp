@@ -14,11 +14,14 @@
 #include "Window/Window.hpp"
 
 #include "AStar.hpp"
+#include "AutomationEngine.hpp"
 #include "Computer.hpp"
+#include "Metrics.hpp"
 #include "Server.hpp"
 
 #include "GUI.hpp"
 #include "SelectBlock.hpp"
+#include "Trace.hpp"
 #include "render_world.hpp"
 #include "world.hpp"
 
@@ -106,12 +109,18 @@ int main()
 		}
 	}
 	RenderWorld render_world;
-	world.dirty_renderer = std::bind(&RenderWorld::dirty, &render_world);
+	world.dirty_renderer
+	    = std::bind(&RenderSnapshots::dirty, &render_world.snapshots);
 	world.dirty_renderer_pathes
-	    = std::bind(&RenderWorld::dirty_paths, &render_world);
+	    = std::bind(&RenderSnapshots::dirty_paths, &render_world.snapshots);
 
 	auto run_result = std::async(&server_manager::run, &s);
 	auto scheduler = std::async(&server_manager::scheduler, &s);
+	AutomationEngine automation{world};
+	automation.after_tick = [&render_world](World &world) {
+		render_world.snapshots.publish(world);
+	};
+	automation.start();
 
 	KeyTracker keyboard;
 
@@ -131,11 +140,11 @@ int main()
 	auto frame_end_time = std::chrono::steady_clock::now();
 	float forwards_movement_speed = 7.5;
 	std::unordered_set<glm::ivec3> blocks_where_we_are_editting_the_value_field;
-
-	//one per server stored in ${world}
-	std::unordered_map<std::string, boost::future<void>> automation_threads;
+	tracer().name_thread("main");
 	while (!stop)
 	{
+		TraceSpan frame{"frame", "frame"};
+		TraceSpan events{"events", "frame"};
 		auto frame_start_time = std::chrono::steady_clock::now();
 		auto dt = frame_start_time - frame_end_time;
 		keyboard.Update(
@@ -237,9 +246,11 @@ int main()
 				break;
 			}
 		}
+		events.end();
 		if (!io.WantCaptureMouse && render_world.selected_server()
 		    && render_world.selected_dimension())
 		{
+			TraceSpan picking{"picking", "frame"};
 			int x, y;
 			SDL_GetMouseState(&x, &y);
 			currently_hovered = find_selected(
@@ -248,27 +259,20 @@ int main()
 			            (static_cast<double>(x) / window_w) * 2 - 1,
 			            ((static_cast<double>(y) / window_h) * 2 - 1) * -1},
 			        render_world},
-			    world,
-			    *render_world.selected_server(),
-			    *render_world.selected_dimension());
+			    render_world.scene());
 			if (currently_hovered.index() == 0)
 			{
 				render_world.select_location(std::nullopt);
 			}
 			else if (currently_hovered.index() == 1)
 			{
-				auto selected_value = std::get<1>(currently_hovered);
-				auto &Block = world.m_blocks[*render_world.selected_server()]
-				                            [*render_world.selected_dimension()]
-				                            [selected_value.x][selected_value.y]
-				                            [selected_value.z];
-				render_world.select_location(Block.position.position);
+				render_world.select_location(std::get<1>(currently_hovered));
 			}
 			else if (currently_hovered.index() == 2)
 			{
 				auto selected_turtle = std::get<2>(currently_hovered);
-				auto &turtle = world.m_turtles[selected_turtle];
-				render_world.select_location(turtle.position.position);
+				render_world.select_location(
+				    render_world.scene().turtles[selected_turtle].position);
 			}
 		}
 		auto ddt = std::chrono::duration_cast<std::chrono::duration<double>>(dt)
@@ -291,11 +295,12 @@ int main()
 			if (!in_freecam)
 			{
 				auto view_dir = render_world.camera.GetViewVector();
-				if (render_world.selected_turtle())
+				auto &turtles = render_world.scene().turtles;
+				if (render_world.selected_turtle()
+				    && *render_world.selected_turtle() < turtles.size())
 				{
-					auto &turtle
-					    = world.m_turtles[*render_world.selected_turtle()];
-					auto turtle_location = glm::dvec3{turtle.position.position}
+					auto &turtle = turtles[*render_world.selected_turtle()];
+					auto turtle_location = glm::dvec3{turtle.position}
 					                       + glm::dvec3{0.5, 0.5, 0.5};
 					render_world.camera.LookAt(turtle_location);
 					render_world.camera.MoveTo(
@@ -316,51 +321,25 @@ int main()
 			}
 		}
 
-		world.add_new_turtles();
-		world.update_pathings();
-		world.update_data_gets();
-		world.get_data_from_turtles();
-
-		for (auto &server : world.m_blocks)
-		{
-			if (automation_threads.find(server.first)
-			    == automation_threads.end())
-			{
-				auto [thread, success] = automation_threads.emplace(
-				    server.first,
-				    boost::future<void>{});
-				if (success)
-				{
-					thread->second = boost::async(
-					    &server_automation,
-					    std::reference_wrapper{world},
-					    thread->first,
-					    std::reference_wrapper{stop});
-				}
-			}
-		}
-
-		std::vector<std::string> to_delete;
-		for (auto &auto_thread : automation_threads)
-		{
-			if (auto_thread.second.is_ready())
-			{
-				to_delete.push_back(auto_thread.first);
-			}
-		}
-		for (auto &del : to_delete)
-		{
-			automation_threads.erase(del);
-		}
-
-		render_world.copy_into_buffers(world, in_freecam);
+		TraceSpan copying{"copy_into_buffers", "frame"};
+		render_world.copy_into_buffers(in_freecam);
+		copying.end();
+		TraceSpan rendering{"render", "frame"};
 		glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
 		render_world.render();
+		rendering.end();
 
+		TraceSpan imgui{"imgui", "frame"};
 		ImGui_ImplOpenGL3_NewFrame();
 		ImGui_ImplSDL2_NewFrame(window);
 		ImGui::NewFrame();
 
+		//the panels change the world directly, the automation engine waits
+		//while they are built
+		std::optional<WorldLock> panel_lock;
+		panel_lock.emplace(world.world_mutex);
+		bool was_pending = render_world.snapshots.pending();
+
 		draw_main_ui(
 		    world,
 		    render_world,
@@ -416,8 +395,7 @@ int main()
 					    currently_selected);
 					if (remove)
 					{
-						world.m_turtles.erase(
-						    world.m_turtles.begin() + selected_turtle);
+						world.remove_turtle(selected_turtle);
 						render_world.dirty();
 					}
 				}
@@ -429,22 +407,41 @@ int main()
 				currently_selected = std::monostate{};
 			}
 		}
+		panel_lock.reset();
+		//the engine publishes what the panels changed, without waiting for
+		//its poll interval
+		if (!was_pending && render_world.snapshots.pending())
+		{
+			world.executor.post([]() {});
+		}
 		ImGui::Render();
 		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+		imgui.end();
 
+		TraceSpan swap{"swap", "frame"};
 		SDL_GL_SwapWindow(window);
+		swap.end();
 
 		auto newer_now = std::chrono::steady_clock::now();
 		auto time_since_last_save = std::chrono::duration_cast<
 		    std::chrono::duration<float, std::ratio<60>>>(newer_now - now);
 		if (time_since_last_save.count() > autosave_interval)
 		{
+			TraceSpan autosave{"autosave", "frame"};
+			WorldLock save_lock{world.world_mutex};
 			std::fstream default_save{
 			    "world_default.save",
 			    std::ios::out | std::ios::trunc};
 			boost::archive::text_oarchive ar{default_save};
 			ar << world;
 			now = newer_now;
+			std::chrono::duration<double> took
+			    = std::chrono::steady_clock::now() - newer_now;
+			metrics()
+			    .histogram(
+			        "controller_autosave_seconds",
+			        "how long an autosave took, waiting for the world included")
+			    .observe(took.count());
 			std::cout << "autosave\n";
 		}
 		frame_end_time = frame_start_time;
@@ -453,6 +450,7 @@ int main()
 	ImGui_ImplSDL2_Shutdown();
 	ImGui::DestroyContext();
 
+	automation.stop();
 	{
 		std::fstream default_save{
 		    "world_default.save",
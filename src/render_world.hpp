@@ -9,6 +9,7 @@
 #include "TexturedMesh/TexturedMesh.hpp"
 #include "ssbo/ssbo.hpp"
 
+#include "RenderSnapshot.hpp"
 #include "world.hpp"
 
 class RenderWorld
@@ -37,94 +38,46 @@ class RenderWorld
 		camera.CreateProjectionX(45.0, 16.0 / 9.0, 0.1, 10000.0);
 	}
 
-	void copy_into_buffers(World &world, bool in_freecam)
+	// uploads whatever the snapshots got since the last frame, doesn't touch
+	// the world
+	void copy_into_buffers(bool in_freecam)
 	{
-		if (m_is_data_dirty)
+		auto scene = snapshots.scene();
+		if (scene != m_scene)
 		{
-			std::scoped_lock<std::mutex> a{world.render_mutex};
-			if (m_selected_turtle && !in_freecam)
+			m_scene = scene;
+			if (m_selected_turtle && !in_freecam
+			    && *m_selected_turtle < m_scene->turtles.size())
 			{
-				auto &turtle = world.m_turtles[*m_selected_turtle];
+				auto &turtle = m_scene->turtles[*m_selected_turtle];
 				auto old_camera_look_at = camera.GetViewVector();
 				auto old_camera_position = camera.GetPosition();
 				auto look_to_pos = old_camera_position - old_camera_look_at;
 				camera.LookAt(
-				    glm::dvec3{turtle.position.position}
-				    + glm::dvec3{0.5, 0.5, 0.5});
+				    glm::dvec3{turtle.position} + glm::dvec3{0.5, 0.5, 0.5});
 				camera.MoveTo(
-				    glm::dvec3{turtle.position.position}
-				    + glm::dvec3{0.5, 0.5, 0.5} + look_to_pos);
+				    glm::dvec3{turtle.position} + glm::dvec3{0.5, 0.5, 0.5}
+				    + look_to_pos);
 			}
-			std::vector<glm::ivec4> new_block_positions;
-			std::vector<glm::vec4> new_block_colors;
-			std::vector<glm::ivec4> new_turtle_positions;
-			std::vector<glm::vec4> new_turtle_colors;
-
-			if (m_selected_server)
-			{
-				auto server = world.m_blocks.find(*m_selected_server);
-				if (m_selected_dimension && server != world.m_blocks.end())
-				{
-					auto dimension = server->second.find(*m_selected_dimension);
-					if (dimension != server->second.end())
-					{
-						for (auto &x : dimension->second)
-						{
-							for (auto &y : x.second)
-							{
-								for (auto &z : y.second)
-								{
-									new_block_positions.emplace_back(
-									    x.first,
-									    y.first,
-									    z.first,
-									    0);
-									new_block_colors.emplace_back(
-									    z.second.color,
-									    1);
-								}
-							}
-						}
-					}
-				}
-			}
-
-			new_turtle_positions.reserve(world.m_turtles.size());
-			new_turtle_colors.reserve(world.m_turtles.size());
-			for (auto &turtle : world.m_turtles)
-			{
-				if (m_selected_server
-				    && *m_selected_server == turtle.position.server
-				    && m_selected_dimension
-				    && *m_selected_dimension == turtle.position.dimension)
-				{
-					new_turtle_positions.emplace_back(
-					    turtle.position.position,
-					    turtle.position.direction);
-					new_turtle_colors.emplace_back(1, 1, 1, 1);
-				}
-			}
-			m_block_positions.LoadData(new_block_positions, GL_STREAM_DRAW);
-			m_block_colors.LoadData(new_block_colors, GL_STREAM_DRAW);
-			m_turtle_positions.LoadData(new_turtle_positions, GL_STREAM_DRAW);
-			m_turtle_colors.LoadData(new_turtle_colors, GL_STREAM_DRAW);
-			m_is_data_dirty = false;
+			m_block_positions.LoadData(
+			    m_scene->block_positions,
+			    GL_STREAM_DRAW);
+			m_block_colors.LoadData(m_scene->block_colors, GL_STREAM_DRAW);
+			m_turtle_positions.LoadData(
+			    m_scene->turtle_positions,
+			    GL_STREAM_DRAW);
+			m_turtle_colors.LoadData(m_scene->turtle_colors, GL_STREAM_DRAW);
 		}
-		if (m_are_pathes_dirty)
+		auto paths = snapshots.paths();
+		if (paths != m_uploaded_paths)
 		{
+			m_uploaded_paths = paths;
 			m_paths.clear();
-			std::scoped_lock<std::mutex> a{world.render_mutex};
-			for (auto &turtle : world.m_turtles)
+			for (auto path : *paths)
 			{
-				if (turtle.current_pathing
-				    && !(turtle.current_pathing->latest_results.size() >= 2))
-				{
-					m_paths.push_back(MeshLine{});
-					m_paths.back().LoadMesh(
-					    turtle.current_pathing->latest_results);
-				}
+				m_paths.push_back(MeshLine{});
+				m_paths.back().LoadMesh(path);
 			}
-			m_are_pathes_dirty = true;
 		}
 	}
 
@@ -161,6 +114,19 @@ class RenderWorld
 			    GL_UNSIGNED_INT,
 			    nullptr);
 		}
+		for (auto &[block, color] : m_scene->value_blocks)
+		{
+			m_basic_shader.SetUniform(
+			    "u_model",
+			    glm::translate(glm::mat4{1}, glm::vec3{block}));
+			m_basic_shader.SetUniform("u_color", color);
+
+			glDrawElements(
+			    GL_TRIANGLES,
+			    m_selected_mesh.GetIndexCount(0),
+			    GL_UNSIGNED_INT,
+			    nullptr);
+		}
 		m_basic_shader.SetUniform("u_color", glm::dvec4{1, 1, 0, 1});
 		for (auto &block : m_value_edits)
 		{
@@ -209,23 +175,29 @@ class RenderWorld
 			glDrawArrays(GL_LINE_STRIP, 0, m_paths[i].GetIndexCount());
 		}
 	}
-	void dirty() { m_is_data_dirty = true; }
+	// from the gui thread, also picks up changes to what is selected
+	void dirty()
+	{
+		snapshots.set_view(
+		    RenderView{m_selected_server, m_selected_dimension, show_values});
+	}
 	void select_server(std::optional<std::string> i = {})
 	{
-		dirty();
 		m_selected_server = i;
+		dirty();
 	}
 	void select_dimension(std::optional<std::string> i = {})
 	{
-		dirty();
 		m_selected_dimension = i;
+		dirty();
 	}
 	void select_turtle(std::optional<size_t> i = {})
 	{
-		dirty();
 		m_selected_turtle = i;
+		dirty();
 	}
-	void dirty_paths() { m_are_pathes_dirty = true; }
+	// the scene the last frame drew, for picking what the mouse is over
+	const RenderScene &scene() const { return *m_scene; }
 	const auto &selected_server() const { return m_selected_server; }
 	const auto &selected_dimension() const { return m_selected_dimension; }
 	const auto &selected_turtle() const { return m_selected_turtle; }
@@ -251,6 +223,8 @@ class RenderWorld
 	}
 
 	Camera camera;
+	bool show_values = false;
+	RenderSnapshots snapshots;
 
 	private:
 	std::optional<std::string> m_selected_server;
@@ -274,6 +248,7 @@ class RenderWorld
 
 	std::vector<glm::ivec3> m_value_edits;
 
-	bool m_is_data_dirty = false;
-	bool m_are_pathes_dirty = false;
+	std::shared_ptr<const RenderScene> m_scene
+	    = std::make_shared<RenderScene>();
+	std::shared_ptr<const RenderPaths> m_uploaded_paths;
 };
@@ -0,0 +1,957 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <boost/asio/ip/tcp.hpp>
+#include <glm/ext.hpp>
+#include <glm/gtx/hash.hpp>
+#include <websocketpp/client.hpp>
+#include <websocketpp/config/asio_no_tls_client.hpp>
+
+#include "nlohmann/json.hpp"
+
+// stands in for a swarm of turtles running websocket_slave.lua, so the
+// controller can be put under load without a minecraft server. every turtle
+// is a websocket client of its own and answers requests the way the lua side
+// does, in a made up world: stone below y 0, grass on top and a wheat field
+// at the origin that keeps growing. it prints how much the controller asked
+// of it, and how long requests took from the controller sending them to it
+// getting the reply, which it reads off the controller's /metrics
+//
+// the controller only sends work for blocks it was told about, to load the
+// automation mark the field in the gui once and start the controller with
+// that save. without one the load is the handshake and the pushes
+
+namespace
+{
+using client = websocketpp::client<websocketpp::config::asio_client>;
+using clock = std::chrono::steady_clock;
+
+constexpr const char *server_name = "simulator";
+constexpr const char *dimension_name = "overworld";
+// the field covers x and z from 0 up to this, turtles start south of it
+constexpr int field_size = 32;
+constexpr int wheat_max_age = 7;
+
+struct Options
+{
+	std::string uri = "ws://localhost:8080";
+	int turtles = 10;
+	// how often every turtle sends what is around it without being asked,
+	// 0 only sends it when the turtle moves like the lua does
+	int push_ms = 0;
+	int grow_ms = 1000;
+	int stats_s = 5;
+	int seconds = 0;
+	int controller_pid = 0;
+};
+
+struct SimBlock
+{
+	std::string name;
+	nlohmann::json state = nlohmann::json::object();
+};
+
+glm::ivec3 orientation_offset(int orientation)
+{
+	switch (orientation & 3)
+	{
+	case 0:
+		return {0, 0, -1};
+	case 1:
+		return {1, 0, 0};
+	case 2:
+		return {0, 0, 1};
+	default:
+		return {-1, 0, 0};
+	}
+}
+
+class SyntheticWorld
+{
+	public:
+	explicit SyntheticWorld(unsigned seed) : m_random(seed) {}
+
+	std::optional<SimBlock> at(glm::ivec3 position) const
+	{
+		if (m_turtles.count(position))
+		{
+			return SimBlock{"computercraft:turtle_advanced"};
+		}
+		if (auto changed = m_changed.find(position); changed != m_changed.end())
+		{
+			return changed->second;
+		}
+		return generated(position);
+	}
+
+	void set(glm::ivec3 position, std::optional<SimBlock> block)
+	{
+		m_changed[position] = std::move(block);
+	}
+
+	// turtles can't move into anything, crops included
+	bool free(glm::ivec3 position) const { return !at(position); }
+
+	void occupy(glm::ivec3 position) { m_turtles.insert(position); }
+	void leave(glm::ivec3 position) { m_turtles.erase(position); }
+
+	// a few random crops on the field grow by a stage
+	void grow(int crops)
+	{
+		std::uniform_int_distribution<int> coordinate{0, field_size - 1};
+		for (int i = 0; i < crops; i++)
+		{
+			glm::ivec3 position{coordinate(m_random), 1, coordinate(m_random)};
+			auto block = at(position);
+			if (!block || block->name != "minecraft:wheat")
+			{
+				continue;
+			}
+			int age = block->state.value("age", 0);
+			if (age < wheat_max_age)
+			{
+				block->state["age"] = age + 1;
+				set(position, block);
+			}
+		}
+	}
+
+	private:
+	static bool in_field(glm::ivec3 position)
+	{
+		return position.x >= 0 && position.x < field_size && position.z >= 0
+		       && position.z < field_size;
+	}
+
+	static std::optional<SimBlock> generated(glm::ivec3 position)
+	{
+		if (position.y < 0)
+		{
+			return SimBlock{"minecraft:stone"};
+		}
+		if (position.y == 0)
+		{
+			if (in_field(position))
+			{
+				return SimBlock{"minecraft:farmland", {{"moisture", 7}}};
+			}
+			return SimBlock{"minecraft:grass_block"};
+		}
+		if (position.y == 1 && in_field(position))
+		{
+			return SimBlock{"minecraft:wheat", {{"age", 0}}};
+		}
+		return std::nullopt;
+	}
+
+	std::unordered_map<glm::ivec3, std::optional<SimBlock>> m_changed;
+	std::unordered_set<glm::ivec3> m_turtles;
+	std::mt19937 m_random;
+};
+
+struct Item
+{
+	std::string name;
+	int count;
+};
+
+struct SimTurtle
+{
+	int index;
+	std::optional<std::string> label;
+	glm::ivec3 position;
+	int orientation = 0;
+	std::array<std::optional<Item>, 16> inventory;
+	client::connection_ptr connection;
+	bool open = false;
+};
+
+// what the lua counts as a failed command, same as World::command_failed
+bool command_failed(const nlohmann::json &result)
+{
+	if (!result.is_object())
+	{
+		return false;
+	}
+	if (result.contains("error"))
+	{
+		return true;
+	}
+	if (auto success = result.find("success");
+	    success != result.end() && success->is_boolean())
+	{
+		return !success->get<bool>();
+	}
+	return false;
+}
+
+// GET /metrics from the host and port in uri, the controller serves it on
+// the port turtles connect to. blocks until it is there or a second is up
+std::optional<std::string> fetch_metrics(const std::string &uri)
+{
+	auto scheme = uri.find("://");
+	auto authority
+	    = uri.substr(scheme == std::string::npos ? 0 : scheme + 3);
+	authority = authority.substr(0, authority.find('/'));
+	auto colon = authority.rfind(':');
+	auto host = authority.substr(0, colon);
+	auto port = colon == std::string::npos ? std::string{"80"}
+	                                       : authority.substr(colon + 1);
+	boost::asio::ip::tcp::iostream stream;
+	stream.expires_after(std::chrono::seconds{1});
+	stream.connect(host, port);
+	if (!stream)
+	{
+		return std::nullopt;
+	}
+	stream << "GET /metrics HTTP/1.0\r\nHost: " << host << "\r\n\r\n"
+	       << std::flush;
+	std::string line;
+	if (!std::getline(stream, line) || line.find(" 200") == std::string::npos)
+	{
+		return std::nullopt;
+	}
+	while (std::getline(stream, line) && line != "\r" && !line.empty())
+	{
+	}
+	std::ostringstream body;
+	body << stream.rdbuf();
+	return body.str();
+}
+
+// controller_request_seconds of every request type added up, cumulative
+// counts by upper bound like prometheus has them
+std::map<double, uint64_t> request_seconds(const std::string &metrics)
+{
+	constexpr std::string_view prefix{"controller_request_seconds_bucket{"};
+	std::map<double, uint64_t> cumulative;
+	std::istringstream lines{metrics};
+	std::string line;
+	while (std::getline(lines, line))
+	{
+		auto le = line.find("le=\"");
+		auto end = line.rfind('}');
+		if (line.compare(0, prefix.size(), prefix) != 0
+		    || le == std::string::npos || end == std::string::npos)
+		{
+			continue;
+		}
+		auto bound = line.substr(le + 4, line.find('"', le + 4) - le - 4);
+		cumulative[bound == "+Inf" ? std::numeric_limits<double>::infinity()
+		                           : std::atof(bound.c_str())]
+		    += std::strtoull(line.c_str() + end + 1, nullptr, 10);
+	}
+	return cumulative;
+}
+
+// estimated from cumulative bucket counts the way Metrics does it, the last
+// bound if it lands in the +Inf bucket
+double percentile(const std::map<double, uint64_t> &cumulative, double fraction)
+{
+	if (cumulative.empty() || cumulative.rbegin()->second == 0)
+	{
+		return 0;
+	}
+	double rank = fraction * cumulative.rbegin()->second;
+	double lower = 0;
+	uint64_t seen = 0;
+	for (auto [bound, count] : cumulative)
+	{
+		if (count >= rank && count != seen)
+		{
+			if (std::isinf(bound))
+			{
+				return lower;
+			}
+			return lower + (bound - lower) * (rank - seen) / (count - seen);
+		}
+		lower = bound;
+		seen = count;
+	}
+	return lower;
+}
+
+// user and system time of a process in seconds, from /proc
+std::optional<double> process_cpu_seconds(int pid)
+{
+	std::ifstream stat{"/proc/" + std::to_string(pid) + "/stat"};
+	std::string line;
+	if (!std::getline(stat, line))
+	{
+		return std::nullopt;
+	}
+	// the command name can contain spaces, the fields start after it
+	std::istringstream fields{line.substr(line.rfind(')') + 2)};
+	std::string field;
+	long ticks = 0;
+	for (int i = 0; i < 13 && fields >> field; i++)
+	{
+		if (i >= 11)
+		{
+			ticks += std::atol(field.c_str());
+		}
+	}
+	return static_cast<double>(ticks) / sysconf(_SC_CLK_TCK);
+}
+
+double own_cpu_seconds()
+{
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec
+	       + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+class Simulator
+{
+	public:
+	explicit Simulator(Options options)
+	    : m_options(options), m_world(12345), m_turtles(options.turtles)
+	{
+		m_endpoint.clear_access_channels(websocketpp::log::alevel::all);
+		m_endpoint.clear_error_channels(websocketpp::log::elevel::all);
+		m_endpoint.init_asio();
+		for (int i = 0; i < options.turtles; i++)
+		{
+			auto &turtle = m_turtles[i];
+			turtle.index = i;
+			// rows of 32 with a gap between turtles, south of the field
+			turtle.position
+			    = glm::ivec3{(i % 32) * 2, 1, field_size + 2 + (i / 32) * 2};
+			m_world.occupy(turtle.position);
+		}
+	}
+
+	void run()
+	{
+		for (auto &turtle : m_turtles)
+		{
+			connect(turtle);
+		}
+		m_last_stats = clock::now();
+		m_last_own_cpu = own_cpu_seconds();
+		if (auto metrics = fetch_metrics(m_options.uri))
+		{
+			m_last_request_seconds = request_seconds(*metrics);
+		}
+		if (m_options.controller_pid)
+		{
+			m_last_controller_cpu
+			    = process_cpu_seconds(m_options.controller_pid).value_or(0);
+		}
+		every(m_options.grow_ms, [this]() { m_world.grow(field_size); });
+		every(m_options.stats_s * 1000, [this]() { report(); });
+		if (m_options.push_ms > 0)
+		{
+			every(m_options.push_ms, [this]() {
+				for (auto &turtle : m_turtles)
+				{
+					if (turtle.open)
+					{
+						push_surroundings(turtle);
+					}
+				}
+			});
+		}
+		if (m_options.seconds > 0)
+		{
+			m_endpoint.set_timer(
+			    m_options.seconds * 1000,
+			    [this](const websocketpp::lib::error_code &) { stop(); });
+		}
+		m_endpoint.run();
+	}
+
+	private:
+	void every(int ms, std::function<void()> work)
+	{
+		m_endpoint.set_timer(
+		    ms,
+		    [this, ms, work](const websocketpp::lib::error_code &error) {
+			    if (error || m_stopping)
+			    {
+				    return;
+			    }
+			    work();
+			    every(ms, work);
+		    });
+	}
+
+	void stop()
+	{
+		m_stopping = true;
+		report();
+		for (auto &turtle : m_turtles)
+		{
+			if (turtle.open)
+			{
+				websocketpp::lib::error_code error;
+				m_endpoint.close(
+				    turtle.connection->get_handle(),
+				    websocketpp::close::status::going_away,
+				    "simulation over",
+				    error);
+			}
+		}
+	}
+
+	void connect(SimTurtle &turtle)
+	{
+		websocketpp::lib::error_code error;
+		turtle.connection = m_endpoint.get_connection(m_options.uri, error);
+		if (error)
+		{
+			std::cerr << "can't connect to " << m_options.uri << ": "
+			          << error.message() << '\n';
+			return;
+		}
+		turtle.connection->set_open_handler(
+		    [this, &turtle](websocketpp::connection_hdl) {
+			    turtle.open = true;
+			    m_connected++;
+			    ready(turtle);
+		    });
+		turtle.connection->set_message_handler(
+		    [this, &turtle](
+		        websocketpp::connection_hdl,
+		        client::message_ptr message) {
+			    recieve(turtle, message->get_payload());
+		    });
+		// the lua tries again until the controller is back
+		auto reconnect = [this, &turtle](websocketpp::connection_hdl) {
+			if (turtle.open)
+			{
+				turtle.open = false;
+				m_connected--;
+			}
+			if (m_stopping)
+			{
+				return;
+			}
+			m_endpoint.set_timer(
+			    1000,
+			    [this, &turtle](const websocketpp::lib::error_code &error) {
+				    if (!error && !m_stopping)
+				    {
+					    connect(turtle);
+				    }
+			    });
+		};
+		turtle.connection->set_close_handler(reconnect);
+		turtle.connection->set_fail_handler(reconnect);
+		m_endpoint.connect(turtle.connection);
+	}
+
+	void send(SimTurtle &turtle, const nlohmann::json &message)
+	{
+		websocketpp::lib::error_code error;
+		m_endpoint.send(
+		    turtle.connection->get_handle(),
+		    message.dump(),
+		    websocketpp::frame::opcode::text,
+		    error);
+	}
+
+	// the controller sends one request at a time and waits for this
+	void ready(SimTurtle &turtle)
+	{
+		send(turtle, {{"special", 1}});
+	}
+
+	void recieve(SimTurtle &turtle, const std::string &payload)
+	{
+		if (payload == "wake_up")
+		{
+			return;
+		}
+		auto request = nlohmann::json::parse(payload, nullptr, false);
+		if (request.is_discarded() || !request.is_object())
+		{
+			return;
+		}
+		m_requests++;
+		if (request.value("request_type", "") == "close")
+		{
+			websocketpp::lib::error_code error;
+			m_endpoint.close(
+			    turtle.connection->get_handle(),
+			    websocketpp::close::status::normal,
+			    "told to stop",
+			    error);
+			return;
+		}
+		auto response = handle(turtle, request);
+		send(
+		    turtle,
+		    {{"request_id", request.value("request_id", 0)},
+		     {"response", response}});
+		ready(turtle);
+	}
+
+	nlohmann::json handle(SimTurtle &turtle, const nlohmann::json &request)
+	{
+		auto type = request.value("request_type", "");
+		auto direction = request.value("direction", "forward");
+		if (type == "command buffer")
+		{
+			return run_buffer(turtle, request);
+		}
+		if (type == "authentication")
+		{
+			return {{"success", true}};
+		}
+		if (type == "eval")
+		{
+			return eval(turtle, request.value("to_eval", ""));
+		}
+		if (type == "move")
+		{
+			return move(turtle, direction);
+		}
+		if (type == "rotate")
+		{
+			turtle.orientation += direction == "left" ? 3 : 1;
+			turtle.orientation &= 3;
+			push_position(turtle);
+			push_surroundings(turtle);
+			return {{"success", true}};
+		}
+		if (type == "inspect")
+		{
+			auto block = block_json(turtle.position + offset(turtle, direction));
+			push_blocks(turtle, nlohmann::json::array({block}));
+			return block;
+		}
+		if (type == "break_block")
+		{
+			return break_block(turtle, direction);
+		}
+		if (type == "place_block")
+		{
+			return place_block(turtle, direction, request.value("slot", 1));
+		}
+		if (type == "inventory")
+		{
+			auto items = nlohmann::json::array();
+			for (auto &item : turtle.inventory)
+			{
+				items.push_back(item_json(item));
+			}
+			return items;
+		}
+		if (type == "inventory_slot")
+		{
+			return item_json(slot(turtle, request.value("slot", 1)));
+		}
+		if (type == "inventory_move")
+		{
+			auto &from = slot(turtle, request.value("from", 1));
+			auto &to = slot(turtle, request.value("to", 1));
+			if (!to)
+			{
+				std::swap(from, to);
+				push_inventory(
+				    turtle,
+				    {request.value("from", 1), request.value("to", 1)});
+			}
+			return {{"success", true}};
+		}
+		if (type == "drop_item")
+		{
+			slot(turtle, request.value("slot", 1)) = std::nullopt;
+			push_inventory(turtle, {request.value("slot", 1)});
+			return {{"success", true}};
+		}
+		if (type == "pickup_item")
+		{
+			return {{"success", true}};
+		}
+		return {{"error", "the simulator doesn't know " + type}};
+	}
+
+	nlohmann::json run_buffer(SimTurtle &turtle, const nlohmann::json &buffer)
+	{
+		auto results = nlohmann::json::array();
+		bool abort = buffer.value("abort_on_failure", false);
+		for (auto &command : buffer.at("commands"))
+		{
+			if (command.value("request_type", "") == "close")
+			{
+				break;
+			}
+			results.push_back(handle(turtle, command));
+			if (abort && command_failed(results.back()))
+			{
+				break;
+			}
+		}
+		return results;
+	}
+
+	// only the evals the controller sends itself, anything else fails like
+	// a lua error would
+	nlohmann::json eval(SimTurtle &turtle, const std::string &code)
+	{
+		if (code.find("position.get()") != std::string::npos)
+		{
+			return {
+			    {"returns",
+			     {true,
+			      turtle.position.x,
+			      turtle.position.y,
+			      turtle.position.z,
+			      turtle.orientation,
+			      dimension_name,
+			      server_name}}};
+		}
+		if (code.find("os.getComputerLabel()") != std::string::npos)
+		{
+			if (turtle.label)
+			{
+				return {{"returns", {true, *turtle.label}}};
+			}
+			return {{"returns", nlohmann::json::array({true})}};
+		}
+		if (auto start = code.find("os.setComputerLabel(\"");
+		    start != std::string::npos)
+		{
+			start += std::string{"os.setComputerLabel(\""}.size();
+			turtle.label = code.substr(start, code.find('"', start) - start);
+			return {{"returns", nlohmann::json::array({true})}};
+		}
+		return {{"returns", {false, "the simulator can't run lua"}}};
+	}
+
+	glm::ivec3 offset(SimTurtle &turtle, const std::string &direction)
+	{
+		if (direction == "up")
+		{
+			return {0, 1, 0};
+		}
+		if (direction == "down")
+		{
+			return {0, -1, 0};
+		}
+		if (direction.rfind("back", 0) == 0)
+		{
+			return -orientation_offset(turtle.orientation);
+		}
+		return orientation_offset(turtle.orientation);
+	}
+
+	nlohmann::json move(SimTurtle &turtle, const std::string &direction)
+	{
+		auto target = turtle.position + offset(turtle, direction);
+		if (!m_world.free(target))
+		{
+			return {{"success", false}, {"error", "Movement obstructed"}};
+		}
+		m_world.leave(turtle.position);
+		turtle.position = target;
+		m_world.occupy(turtle.position);
+		push_position(turtle);
+		push_surroundings(turtle);
+		return {{"success", true}};
+	}
+
+	nlohmann::json break_block(SimTurtle &turtle, const std::string &direction)
+	{
+		auto target = turtle.position + offset(turtle, direction);
+		auto block = m_world.at(target);
+		if (!block || block->name == "computercraft:turtle_advanced")
+		{
+			return {{"success", false}, {"error", "Nothing to dig here"}};
+		}
+		m_world.set(target, std::nullopt);
+		if (block->name == "minecraft:wheat")
+		{
+			auto seeds = give(turtle, "minecraft:wheat_seeds");
+			int wheat = 0;
+			if (block->state.value("age", 0) == wheat_max_age)
+			{
+				wheat = give(turtle, "minecraft:wheat");
+			}
+			push_inventory(turtle, {seeds, wheat});
+		}
+		else
+		{
+			push_inventory(turtle, {give(turtle, block->name)});
+		}
+		push_blocks(turtle, nlohmann::json::array({block_json(target)}));
+		return {{"success", true}};
+	}
+
+	nlohmann::json
+	place_block(SimTurtle &turtle, const std::string &direction, int slot_index)
+	{
+		auto target = turtle.position + offset(turtle, direction);
+		auto &item = slot(turtle, slot_index);
+		if (!item || !m_world.free(target))
+		{
+			return {{"success", false}, {"error", "Cannot place block here"}};
+		}
+		if (item->name == "minecraft:wheat_seeds")
+		{
+			m_world.set(target, SimBlock{"minecraft:wheat", {{"age", 0}}});
+		}
+		else
+		{
+			m_world.set(target, SimBlock{item->name});
+		}
+		if (--item->count == 0)
+		{
+			item = std::nullopt;
+		}
+		push_inventory(turtle, {slot_index});
+		push_blocks(turtle, nlohmann::json::array({block_json(target)}));
+		return {{"success", true}};
+	}
+
+	static std::optional<Item> &slot(SimTurtle &turtle, int slot)
+	{
+		return turtle.inventory[std::clamp(slot, 1, 16) - 1];
+	}
+
+	// the slot it went in, counted from 1, 0 if the inventory is full
+	static int give(SimTurtle &turtle, const std::string &name)
+	{
+		for (size_t i = 0; i < turtle.inventory.size(); i++)
+		{
+			auto &item = turtle.inventory[i];
+			if (item && item->name == name && item->count < 64)
+			{
+				item->count++;
+				return i + 1;
+			}
+		}
+		for (size_t i = 0; i < turtle.inventory.size(); i++)
+		{
+			if (!turtle.inventory[i])
+			{
+				turtle.inventory[i] = Item{name, 1};
+				return i + 1;
+			}
+		}
+		return 0;
+	}
+
+	static nlohmann::json item_json(const std::optional<Item> &item)
+	{
+		if (!item)
+		{
+			return nullptr;
+		}
+		return {{"name", item->name}, {"count", item->count}, {"damage", 0}};
+	}
+
+	nlohmann::json block_json(glm::ivec3 position)
+	{
+		nlohmann::json json{
+		    {"position", {position.x, position.y, position.z}},
+		    {"dimension", dimension_name},
+		    {"server", server_name}};
+		if (auto block = m_world.at(position))
+		{
+			json["found_block"] = true;
+			json["block"]
+			    = {{"name", block->name},
+			       {"metadata", 0},
+			       {"state", block->state}};
+		}
+		else
+		{
+			json["found_block"] = false;
+		}
+		return json;
+	}
+
+	void push_position(SimTurtle &turtle)
+	{
+		m_pushes++;
+		send(
+		    turtle,
+		    {{"request_id", -2},
+		     {"response",
+		      {{"x", turtle.position.x},
+		       {"y", turtle.position.y},
+		       {"z", turtle.position.z},
+		       {"o", turtle.orientation},
+		       {"dimension", dimension_name},
+		       {"server", server_name}}}});
+	}
+
+	// the slots changed, like the turtle_inventory event. 0 is no slot
+	void push_inventory(SimTurtle &turtle, std::initializer_list<int> slots)
+	{
+		auto changes = nlohmann::json::array();
+		for (auto changed : slots)
+		{
+			if (changed != 0)
+			{
+				changed = std::clamp(changed, 1, 16);
+				changes.push_back(
+				    {{"slot", changed},
+				     {"item", item_json(slot(turtle, changed))}});
+			}
+		}
+		if (changes.empty())
+		{
+			return;
+		}
+		m_pushes++;
+		send(turtle, {{"request_id", -3}, {"response", std::move(changes)}});
+	}
+
+	void push_blocks(SimTurtle &turtle, nlohmann::json blocks)
+	{
+		m_pushes++;
+		send(turtle, {{"request_id", -1}, {"response", std::move(blocks)}});
+	}
+
+	// what the turtle sees in front, above and below, like after a move
+	void push_surroundings(SimTurtle &turtle)
+	{
+		push_blocks(
+		    turtle,
+		    {block_json(turtle.position + offset(turtle, "forward")),
+		     block_json(turtle.position + offset(turtle, "up")),
+		     block_json(turtle.position + offset(turtle, "down"))});
+	}
+
+	void report()
+	{
+		auto now = clock::now();
+		std::chrono::duration<double> elapsed = now - m_last_stats;
+		// only what was answered since the last report
+		std::map<double, uint64_t> replies;
+		if (auto metrics = fetch_metrics(m_options.uri))
+		{
+			auto cumulative = request_seconds(*metrics);
+			for (auto [bound, count] : cumulative)
+			{
+				auto last = m_last_request_seconds.find(bound);
+				replies[bound] = last == m_last_request_seconds.end()
+				                         || last->second > count
+				                     ? count
+				                     : count - last->second;
+			}
+			m_last_request_seconds = std::move(cumulative);
+		}
+		auto own_cpu = own_cpu_seconds();
+		std::cout << "turtles " << m_connected << '/' << m_turtles.size()
+		          << ", " << m_requests / elapsed.count() << " requests/s, "
+		          << m_pushes / elapsed.count() << " pushes/s"
+		          << ", request to reply ms p50 "
+		          << 1000 * percentile(replies, 0.5) << " p90 "
+		          << 1000 * percentile(replies, 0.9) << " p99 "
+		          << 1000 * percentile(replies, 0.99) << ", simulator cpu "
+		          << 100 * (own_cpu - m_last_own_cpu) / elapsed.count() << '%';
+		if (m_options.controller_pid)
+		{
+			if (auto cpu = process_cpu_seconds(m_options.controller_pid))
+			{
+				std::cout << ", controller cpu "
+				          << 100 * (*cpu - m_last_controller_cpu)
+				                 / elapsed.count()
+				          << '%';
+				m_last_controller_cpu = *cpu;
+			}
+		}
+		std::cout << '\n';
+		m_requests = 0;
+		m_pushes = 0;
+		m_last_stats = now;
+		m_last_own_cpu = own_cpu;
+	}
+
+	Options m_options;
+	client m_endpoint;
+	SyntheticWorld m_world;
+	// never resized, the connection handlers hold on to their turtle
+	std::vector<SimTurtle> m_turtles;
+	bool m_stopping = false;
+	int m_connected = 0;
+
+	clock::time_point m_last_stats;
+	uint64_t m_requests = 0;
+	uint64_t m_pushes = 0;
+	// the controller's request_seconds at the last report
+	std::map<double, uint64_t> m_last_request_seconds;
+	double m_last_own_cpu = 0;
+	double m_last_controller_cpu = 0;
+};
+
+void print_usage(const char *name)
+{
+	std::cerr
+	    << "usage: " << name
+	    << " [--turtles n] [--uri ws://host:port] [--push-ms n] [--grow-ms n]"
+	       " [--stats-s n] [--seconds n] [--controller-pid pid]\n"
+	    << "  --turtles         how many turtles connect (default 10)\n"
+	    << "  --uri             where the controller listens (default"
+	       " ws://localhost:8080)\n"
+	    << "  --push-ms         every turtle also sends its surroundings this"
+	       " often, 0 only after moving (default 0)\n"
+	    << "  --grow-ms         how often crops on the field grow (default"
+	       " 1000)\n"
+	    << "  --stats-s         seconds between reports (default 5)\n"
+	    << "  --seconds         stop after this long, 0 runs until killed\n"
+	    << "  --controller-pid  also report the cpu use of this process\n";
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+	Options options;
+	std::unordered_map<std::string, int *> numbers{
+	    {"--turtles", &options.turtles},
+	    {"--push-ms", &options.push_ms},
+	    {"--grow-ms", &options.grow_ms},
+	    {"--stats-s", &options.stats_s},
+	    {"--seconds", &options.seconds},
+	    {"--controller-pid", &options.controller_pid}};
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (auto number = numbers.find(argument);
+		    number != numbers.end() && i + 1 < argc)
+		{
+			*number->second = std::atoi(argv[++i]);
+		}
+		else if (argument == "--uri" && i + 1 < argc)
+		{
+			options.uri = argv[++i];
+		}
+		else
+		{
+			print_usage(argv[0]);
+			return argument == "--help" ? 0 : 1;
+		}
+	}
+	if (options.turtles <= 0 || options.grow_ms <= 0 || options.stats_s <= 0)
+	{
+		std::cerr << "--turtles, --grow-ms and --stats-s have to be above 0\n";
+		return 1;
+	}
+
+	Simulator simulator{options};
+	simulator.run();
+}
@@ -1,5 +1,8 @@
 #include "world.hpp"
 
+#include "Assignment.hpp"
+#include "Trace.hpp"
+
 CommandBuffer<nlohmann::json> Turtle::rotate_1{};
 CommandBuffer<nlohmann::json> Turtle::rotate_2{};
 CommandBuffer<nlohmann::json> Turtle::rotate_3{};
@@ -15,24 +18,119 @@ CommandBuffer<nlohmann::json> Turtle::up{};
 CommandBuffer<nlohmann::json> Turtle::down{};
 Turtle::static_init_t Turtle::static_init{};
 
-Pathing::Pathing(glm::ivec3 _target, Turtle &turtle, World &world)
-{
-	target = _target;
-	pather = std::make_unique<AStar>(
-	    turtle.position.position,
-	    _target,
-	    world.make_turtle_obstacle_function(turtle));
-	result = boost::async(&AStar::run, pather.get());
-}
 Pathing::Pathing(
     glm::ivec3 _target,
     Turtle &turtle,
-    std::function<bool(glm::ivec3)> obstacle)
+    World &world,
+    PlannerKind _kind,
+    ObstacleKind _obstacles)
 {
 	target = _target;
-	pather
-	    = std::make_unique<AStar>(turtle.position.position, _target, obstacle);
-	result = boost::async(&AStar::run, pather.get());
+	kind = _kind;
+	obstacles = _obstacles;
+	cacheable = true;
+	auto obstacle = world.shared_obstacle_function(world.make_obstacle_function(
+	    obstacles,
+	    turtle,
+	    kind != PlannerKind::cooperative));
+	auto find_cached = [&world,
+	                    _target,
+	                    _obstacles,
+	                    server = turtle.position.server,
+	                    dimension = turtle.position.dimension](glm::ivec3 from) {
+		return world.route_cache.find(
+		    RouteKey{server, dimension, from, _target, _obstacles},
+		    world.versions_for(server, dimension));
+	};
+	switch (kind)
+	{
+	case PlannerKind::astar:
+		make_pather = [_target, obstacle, find_cached](
+		                  glm::ivec3 from) -> std::unique_ptr<Planner> {
+			if (auto cached = find_cached(from))
+			{
+				return std::make_unique<CachedRoute>(*cached, obstacle);
+			}
+			return std::make_unique<AStar>(from, _target, obstacle);
+		};
+		break;
+	case PlannerKind::cooperative:
+		make_pather = [_target,
+		               obstacle,
+		               find_cached,
+		               &reservations = world.reservations_for(turtle.position),
+		               owner = turtle.name](glm::ivec3 from) {
+			return std::make_unique<CooperativeAStar>(
+			    from,
+			    _target,
+			    obstacle,
+			    reservations,
+			    owner,
+			    CooperativeAStar::default_window,
+			    find_cached(from));
+		};
+		break;
+	case PlannerKind::bidirectional:
+		make_pather = [_target, obstacle, find_cached](
+		                  glm::ivec3 from) -> std::unique_ptr<Planner> {
+			if (auto cached = find_cached(from))
+			{
+				return std::make_unique<CachedRoute>(*cached, obstacle);
+			}
+			return std::make_unique<BidirectionalAStar>(from, _target, obstacle);
+		};
+		break;
+	case PlannerKind::jump_point:
+		make_pather = [_target, obstacle, find_cached](
+		                  glm::ivec3 from) -> std::unique_ptr<Planner> {
+			if (auto cached = find_cached(from))
+			{
+				return std::make_unique<CachedRoute>(*cached, obstacle);
+			}
+			return std::make_unique<JumpPointSearch>(from, _target, obstacle);
+		};
+		break;
+	}
+	report_search = [&world, turtle_name = turtle.name](
+	                    uint64_t step,
+	                    bool found) {
+		world.executor.post([&world, turtle_name, step, found]() {
+			world.search_finished(turtle_name, step, found);
+		});
+	};
+	start(turtle.position.position);
+}
+
+void Pathing::start(glm::ivec3 from)
+{
+	if (pather)
+	{
+		pather->stop = true;
+	}
+	pather = make_pather(from);
+	step = next_step++;
+	boost::async([pather = pather, report = report_search, step = step]() {
+		TraceSpan span{pather->name(), "search"};
+		auto started = std::chrono::steady_clock::now();
+		auto found = pather->run();
+		span.end();
+		std::chrono::duration<double> took
+		    = std::chrono::steady_clock::now() - started;
+		MetricLabels labels{{"planner", pather->name()}};
+		metrics()
+		    .counter(
+		        "controller_planner_expanded_nodes_total",
+		        "nodes searches took off their open list",
+		        labels)
+		    .add(pather->expanded_nodes);
+		metrics()
+		    .histogram(
+		        "controller_planner_search_seconds",
+		        "how long a search ran",
+		        labels)
+		    .observe(took.count());
+		report(step, found);
+	});
 }
 
 Direction operator+(Direction a, int i)
@@ -55,32 +153,21 @@ std::optional<std::reference_wrapper<Turtle>> find_closest_turtle(
     std::string server_name,
     std::string dimension)
 {
-	std::multimap<double, std::reference_wrapper<Turtle>> turtles;
-	for (auto &turtle : world.m_turtles)
-	{
-		if (turtle.position.server == server_name
-		    && turtle.position.dimension == dimension)
-		{
-			if ((turtle.value.job & jobs) != 0
-			    && turtle.value.current_action == std::nullopt)
-			{
-				turtles.emplace(
-				    glm::distance(
-				        glm::dvec3{turtle.position.position},
-				        glm::dvec3{position}),
-				    turtle);
-			}
-		}
-	}
-	auto turtle_iter = turtles.begin();
-	if (turtle_iter == turtles.end())
+	auto index = world.turtle_index.nearest(
+	    server_name,
+	    dimension,
+	    position,
+	    [&world, jobs](size_t i) {
+		    auto &turtle = world.m_turtles[i];
+		    return (turtle.value.job & jobs) != 0
+		           && turtle.value.current_action == std::nullopt
+		           && !turtle.connection.expired();
+	    });
+	if (!index)
 	{
 		return std::nullopt;
 	}
-	else
-	{
-		return turtle_iter->second;
-	}
+	return world.m_turtles[*index];
 }
 
 std::optional<std::reference_wrapper<Turtle>> find_closest_turtle(
@@ -112,408 +199,746 @@ std::optional<int> find_item_slot(Turtle &turtle, std::string name)
 	return std::nullopt;
 }
 
-void server_automation(World &world, const std::string server_name, bool &stop)
+Pathing automation_pathing(glm::ivec3 target, Turtle &turtle, World &world)
+{
+	auto kind = world.server_settings[turtle.position.server].cooperative_pathing
+	                ? PlannerKind::cooperative
+	                : PlannerKind::astar;
+	return Pathing{target, turtle, world, kind, ObstacleKind::allow_mining};
+}
+
+// how long a due block waits before trying again when no turtle is free
+constexpr auto recheck_retry = 5s;
+
+// harvests that didn't get a turtle of their own are added onto the tours
+// of the farmers that did, up to this many stops a tour
+constexpr size_t max_tour_stops = 16;
+
+// what a due block needs from a turtle, worked out before any turtle is picked
+struct DueTask
 {
-	while (!stop)
+	BlockScheduler::Due block;
+	TurtleValue::actions action;
+	TurtleValue::jobs jobs;
+};
+
+// whether some turtle is harvesting the block or has it further up its tour
+bool harvest_underway(
+    World &world,
+    const std::string &server_name,
+    const BlockScheduler::Due &due)
+{
+	for (auto &turtle : world.m_turtles)
 	{
-		if (world.m_blocks.find(server_name) == world.m_blocks.end())
+		if (turtle.position.server != server_name
+		    || turtle.position.dimension != due.dimension)
 		{
-			//this server no longer exists
-			return;
+			continue;
 		}
-		//first, check all turtles and make sure they are doing thier current actions
+		if (turtle.value.current_action == TurtleValue::harvest_plant
+		    && turtle.value.where == due.position)
+		{
+			return true;
+		}
+		for (auto &stop : turtle.value.queued_harvests)
+		{
+			if (stop == due.position)
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+// blocks that don't need a turtle right now are dealt with here and give
+// nullopt
+std::optional<DueTask> task_for(
+    World &world,
+    const std::string &server_name,
+    const BlockScheduler::Due &due)
+{
+	auto block_opt = world.block_at(server_name, due.dimension, due.position);
+	if (!block_opt || !block_opt->get().value)
+	{
+		//the block or its job is gone, it drops out of the schedule
+		return std::nullopt;
+	}
+	auto &block = block_opt->get();
+	if (world.is_mature(block))
+	{
+		if (harvest_underway(world, server_name, due))
+		{
+			//it came due again before its tour got to it
+			world.block_scheduler_for(server_name)
+			    .schedule(
+			        due.dimension,
+			        due.position,
+			        std::chrono::steady_clock::now() + recheck_retry);
+			return std::nullopt;
+		}
+		return DueTask{due, TurtleValue::harvest_plant, TurtleValue::FARMER};
+	}
+	if (block.value->is_being_checked)
+	{
 		for (auto &turtle : world.m_turtles)
 		{
-			if (turtle.position.server != server_name
-			    || !turtle.value.current_action)
+			if (turtle.value.current_action == TurtleValue::checking_block
+			    && turtle.value.where == due.position
+			    && turtle.position.server == server_name
+			    && turtle.position.dimension == due.dimension)
 			{
-				continue;
+				world.block_scheduler_for(server_name)
+				    .schedule(
+				        due.dimension,
+				        due.position,
+				        std::chrono::steady_clock::now() + recheck_retry);
+				return std::nullopt;
 			}
-			if (turtle.connection.expired())
+		}
+		//whoever was checking it gave up
+		block.value->is_being_checked = false;
+	}
+	return DueTask{
+	    due,
+	    TurtleValue::checking_block,
+	    block.value->associated_jobs};
+}
+
+void hand_out(
+    World &world,
+    const std::string &server_name,
+    const DueTask &task,
+    std::optional<std::reference_wrapper<Turtle>> turtle_opt)
+{
+	auto &scheduler = world.block_scheduler_for(server_name);
+	auto now = std::chrono::steady_clock::now();
+	auto block
+	    = world.block_at(server_name, task.block.dimension, task.block.position);
+	if (!turtle_opt || !block)
+	{
+		scheduler.schedule(
+		    task.block.dimension,
+		    task.block.position,
+		    now + recheck_retry);
+		return;
+	}
+	auto &turtle = turtle_opt->get();
+	auto &value = block->get().value;
+	turtle.value.current_action = task.action;
+	turtle.value.where = task.block.position;
+	if (task.action == TurtleValue::harvest_plant)
+	{
+		turtle.value.direction
+		    = std::variant<Direction, std::monostate, std::monostate>{
+		        std::in_place_index<2>};
+		value->last_check = now;
+		world.schedule_recheck(*block);
+	}
+	else
+	{
+		//oh boi it's recheck time
+		turtle.value.current_offset = glm::ivec3{0, -1, 0};
+		value->is_being_checked = true;
+		//comes back to see if the check finished, finishing it reschedules
+		//the block properly
+		scheduler.schedule(
+		    task.block.dimension,
+		    task.block.position,
+		    now + recheck_retry);
+	}
+}
+
+// puts a harvest at the back of a turtle's tour, the block counts as looked
+// after from now on like one handed out directly
+void queue_harvest(
+    World &world,
+    const std::string &server_name,
+    const DueTask &task,
+    Turtle &turtle)
+{
+	auto block
+	    = world.block_at(server_name, task.block.dimension, task.block.position);
+	if (!block)
+	{
+		return;
+	}
+	block->get().value->last_check = std::chrono::steady_clock::now();
+	world.schedule_recheck(*block);
+	turtle.value.queued_harvests.push_back(task.block.position);
+}
+
+// orders the harvests by distance in the open from where the turtle is,
+// starts it on the first and queues up the rest. walking distances take a
+// search from every stop, they are worked out on a thread of their own and
+// the rest of the queue is put in that order if it hasn't changed by then
+void hand_out_tour(
+    World &world,
+    const std::string &server_name,
+    const std::vector<DueTask> &tasks,
+    std::vector<size_t> stops,
+    Turtle &turtle)
+{
+	if (stops.size() > 1)
+	{
+		std::vector<glm::ivec3> points{turtle.position.position};
+		for (auto stop : stops)
+		{
+			points.push_back(tasks[stop].block.position);
+		}
+		// no expansions leaves every distance the manhattan one
+		auto order = plan_tour(path_distances(points, nullptr, 0));
+		std::vector<size_t> ordered;
+		for (auto point : order)
+		{
+			ordered.push_back(stops[point - 1]);
+		}
+		stops = std::move(ordered);
+	}
+	hand_out(world, server_name, tasks[stops[0]], turtle);
+	for (size_t i = 1; i < stops.size(); i++)
+	{
+		queue_harvest(world, server_name, tasks[stops[i]], turtle);
+	}
+	if (turtle.value.queued_harvests.size() < 2)
+	{
+		return;
+	}
+	// from the first stop on, the turtle is on its way there already
+	std::vector<glm::ivec3> points{tasks[stops[0]].block.position};
+	points.insert(
+	    points.end(),
+	    turtle.value.queued_harvests.begin(),
+	    turtle.value.queued_harvests.end());
+	boost::async([&world,
+	              name = turtle.name,
+	              points = std::move(points),
+	              obstacle = world.shared_obstacle_function(
+	                  world.make_obstacle_function(
+	                      ObstacleKind::allow_mining,
+	                      turtle,
+	                      false))]() {
+		TraceSpan span{"tour distances", "search"};
+		auto order = plan_tour(path_distances(points, obstacle));
+		span.end();
+		world.executor.post([&world, name, points, order]() {
+			auto turtle = world.turtle_named(name);
+			std::deque<glm::ivec3> planned{points.begin() + 1, points.end()};
+			if (!turtle || turtle->value.queued_harvests != planned)
 			{
-				continue;
+				return;
 			}
-			if (turtle.value.current_action == TurtleValue::place_block
-			    || turtle.value.current_action == TurtleValue::destroy_block
-			    || turtle.value.current_action == TurtleValue::harvest_plant)
+			turtle->value.queued_harvests.clear();
+			for (auto point : order)
 			{
-				if (!turtle.current_pathing)
-				{
-					turtle.current_pathing = Pathing{
-					    turtle.value.where,
-					    turtle,
-					    world.make_turtle_allow_mining_obstacle_function(
-					        turtle)};
-				}
-				else if (turtle.current_pathing->target != turtle.value.where)
+				turtle->value.queued_harvests.push_back(points[point]);
+			}
+		});
+	});
+}
+
+// moves a turtle that finished a harvest on to the next stop of its tour,
+// plants that are gone or lost their value since the tour was made are
+// skipped
+void start_next_harvest(World &world, Turtle &turtle)
+{
+	while (!turtle.value.queued_harvests.empty())
+	{
+		auto where = turtle.value.queued_harvests.front();
+		turtle.value.queued_harvests.pop_front();
+		auto block = world.block_at(
+		    turtle.position.server,
+		    turtle.position.dimension,
+		    where);
+		if (block && block->get().value)
+		{
+			turtle.value.current_action = TurtleValue::harvest_plant;
+			turtle.value.where = where;
+			turtle.value.direction
+			    = std::variant<Direction, std::monostate, std::monostate>{
+			        std::in_place_index<2>};
+			return;
+		}
+	}
+}
+
+// parks a script that can't go on until its action is stopped from the gui
+struct Stuck : std::suspend_always
+{
+};
+
+// walks over the 3x3 around where a plant was, picking up what it dropped,
+// then goes on with the next harvest of its tour
+TurtleTask pick_up_plant_drops(World &world, std::string name)
+{
+	auto center = world.turtle_named(name)->value.where;
+	for (int z = -1; z <= 1; z++)
+	{
+		for (int x = -1; x <= 1; x++)
+		{
+			auto &turtle = *world.turtle_named(name);
+			turtle.value.current_offset = glm::ivec3{x, 0, z};
+			if (!co_await walk(
+			        world,
+			        name,
+			        automation_pathing(
+			            center + turtle.value.current_offset,
+			            turtle,
+			            world)))
+			{
+				co_await Stuck{};
+			}
+			// the turtle runs requests in order, the next walk can go out
+			// without waiting for this
+			if (auto con = world.turtle_named(name)->connection.lock())
+			{
+				con->pickup_item("down");
+			}
+		}
+	}
+	auto &turtle = *world.turtle_named(name);
+	turtle.value.current_action = std::nullopt;
+	start_next_harvest(world, turtle);
+}
+
+// goes next to the block so the turtle sees it, below it first, then above,
+// then from the sides
+TurtleTask check_block(World &world, std::string name)
+{
+	auto where = world.turtle_named(name)->value.where;
+	constexpr glm::ivec3 offsets[]{
+	    {0, -1, 0},
+	    {0, 1, 0},
+	    {-1, 0, 0},
+	    {1, 0, 0},
+	    {0, 0, -1},
+	    {0, 0, 1}};
+	for (auto offset : offsets)
+	{
+		auto &turtle = *world.turtle_named(name);
+		turtle.value.current_offset = offset;
+		if (!co_await walk(
+		        world,
+		        name,
+		        automation_pathing(where + offset, turtle, world)))
+		{
+			continue;
+		}
+		if (offset.y == 0)
+		{
+			co_await until_ready(
+			    world,
+			    world.turtle_named(name)->point_future(
+			        orientation_to_direction(-offset)));
+		}
+		auto &checker = *world.turtle_named(name);
+		checker.value.current_action = std::nullopt;
+		auto block = world.block_at(
+		    checker.position.server,
+		    checker.position.dimension,
+		    where);
+		if (block && block->get().value)
+		{
+			block->get().value->is_being_checked = false;
+			block->get().value->last_check = std::chrono::steady_clock::now();
+			world.schedule_recheck(*block);
+		}
+		co_return;
+	}
+	//unable to get to block
+	co_await Stuck{};
+}
+
+// everything that came due together is matched against the idle turtles in
+// one go, grabbing the closest turtle block by block sends turtles criss
+// crossing the farm when a field ripens at once. a farmer gets every harvest
+// close to the one it was matched with as a tour instead of one at a time
+void assign_due_blocks(
+    World &world,
+    const std::string &server_name,
+    const std::vector<BlockScheduler::Due> &due)
+{
+	std::unordered_map<std::string, std::vector<DueTask>> by_dimension;
+	for (auto &block : due)
+	{
+		if (auto task = task_for(world, server_name, block))
+		{
+			by_dimension[block.dimension].push_back(*task);
+		}
+	}
+	for (auto &[dimension, tasks] : by_dimension)
+	{
+		if (tasks.size() == 1)
+		{
+			hand_out(
+			    world,
+			    server_name,
+			    tasks[0],
+			    find_closest_turtle(
+			        tasks[0].block.position,
+			        tasks[0].jobs,
+			        world,
+			        server_name,
+			        dimension));
+			continue;
+		}
+		int wanted_jobs = 0;
+		for (auto &task : tasks)
+		{
+			wanted_jobs |= task.jobs;
+		}
+		std::vector<size_t> idle;
+		for (size_t i = 0; i < world.m_turtles.size(); i++)
+		{
+			auto &turtle = world.m_turtles[i];
+			if (turtle.position.server == server_name
+			    && turtle.position.dimension == dimension
+			    && (turtle.value.job & wanted_jobs) != 0
+			    && turtle.value.current_action == std::nullopt
+			    && !turtle.connection.expired())
+			{
+				idle.push_back(i);
+			}
+		}
+		std::vector<std::vector<double>> cost(
+		    tasks.size(),
+		    std::vector<double>(idle.size()));
+		for (size_t t = 0; t < tasks.size(); t++)
+		{
+			for (size_t i = 0; i < idle.size(); i++)
+			{
+				auto &turtle = world.m_turtles[idle[i]];
+				cost[t][i] = (turtle.value.job & tasks[t].jobs) != 0
+				                 ? glm::distance(
+				                     glm::dvec3{turtle.position.position},
+				                     glm::dvec3{tasks[t].block.position})
+				                 : std::numeric_limits<double>::infinity();
+			}
+		}
+		auto assignment = solve_assignment(cost);
+		// harvests by index into tasks, tour_turtles[i] does tours[i]
+		std::vector<std::vector<size_t>> tours;
+		std::vector<size_t> tour_turtles, left_over;
+		for (size_t t = 0; t < tasks.size(); t++)
+		{
+			bool harvest = tasks[t].action == TurtleValue::harvest_plant;
+			if (harvest && assignment[t])
+			{
+				tours.push_back({t});
+				tour_turtles.push_back(idle[*assignment[t]]);
+			}
+			else if (harvest)
+			{
+				left_over.push_back(t);
+			}
+			else
+			{
+				std::optional<std::reference_wrapper<Turtle>> turtle;
+				if (assignment[t])
 				{
-					turtle.current_pathing = Pathing{
-					    turtle.value.where,
-					    turtle,
-					    world.make_turtle_allow_mining_obstacle_function(
-					        turtle)};
+					turtle = world.m_turtles[idle[*assignment[t]]];
 				}
-				else
+				hand_out(world, server_name, tasks[t], turtle);
+			}
+		}
+		std::vector<glm::ivec3> positions;
+		for (auto &task : tasks)
+		{
+			positions.push_back(task.block.position);
+		}
+		for (auto t : grow_tours(positions, tours, left_over, max_tour_stops))
+		{
+			hand_out(world, server_name, tasks[t], std::nullopt);
+		}
+		for (size_t i = 0; i < tours.size(); i++)
+		{
+			hand_out_tour(
+			    world,
+			    server_name,
+			    tasks,
+			    tours[i],
+			    world.m_turtles[tour_turtles[i]]);
+		}
+	}
+}
+
+void start_server_automation(World &world, const std::string &server_name)
+{
+	//everything with a value comes up check_every after it was last looked at
+	for (auto &dimension : world.value_index.dimensions(server_name))
+	{
+		for (auto &position : world.value_index.find(server_name, dimension))
+		{
+			if (auto block = world.block_at(server_name, dimension, position))
+			{
+				world.schedule_recheck(*block);
+			}
+		}
+	}
+}
+
+// a turtle that closed its connection or was dropped for not answering hands
+// the blocks it was going to see to back straight away, instead of them
+// waiting for it to come back. what it was told to do from the gui it keeps
+void release_work(World &world, const std::string &server_name, Turtle &turtle)
+{
+	auto action = turtle.value.current_action;
+	if (action != TurtleValue::harvest_plant
+	    && action != TurtleValue::picking_up_plant_drops
+	    && action != TurtleValue::checking_block)
+	{
+		return;
+	}
+	auto &scheduler = world.block_scheduler_for(server_name);
+	auto now = std::chrono::steady_clock::now();
+	auto &dimension = turtle.position.dimension;
+	if (action == TurtleValue::checking_block)
+	{
+		auto block = world.block_at(server_name, dimension, turtle.value.where);
+		if (block && block->get().value)
+		{
+			block->get().value->is_being_checked = false;
+		}
+	}
+	// picking up drops is where a plant was, that one was harvested already
+	if (action != TurtleValue::picking_up_plant_drops)
+	{
+		scheduler.schedule(dimension, turtle.value.where, now);
+	}
+	for (auto &stop : turtle.value.queued_harvests)
+	{
+		scheduler.schedule(dimension, stop, now);
+	}
+	turtle.value.queued_harvests.clear();
+	turtle.value.current_action = std::nullopt;
+	turtle.value.task.reset();
+	turtle.replace_pathing();
+}
+
+void server_automation_step(World &world, const std::string &server_name)
+{
+	//first, check all turtles and make sure they are doing thier current actions
+	for (auto &turtle : world.m_turtles)
+	{
+		if (turtle.value.task && turtle.value.task->done())
+		{
+			// started again it would only throw again
+			if (turtle.value.task->failed())
+			{
+				turtle.value.current_action = std::nullopt;
+			}
+			turtle.value.task.reset();
+		}
+		if (turtle.position.server != server_name
+		    || !turtle.value.current_action)
+		{
+			continue;
+		}
+		if (turtle.connection.expired())
+		{
+			release_work(world, server_name, turtle);
+			continue;
+		}
+		if (turtle.value.current_action == TurtleValue::place_block
+		    || turtle.value.current_action == TurtleValue::destroy_block
+		    || turtle.value.current_action == TurtleValue::harvest_plant)
+		{
+			if (!turtle.current_pathing)
+			{
+				turtle.replace_pathing(
+				    automation_pathing(turtle.value.where, turtle, world));
+			}
+			else if (turtle.current_pathing->target != turtle.value.where)
+			{
+				turtle.replace_pathing(
+				    automation_pathing(turtle.value.where, turtle, world));
+			}
+			else
+			{
+				if (turtle.current_pathing->finished)
 				{
-					if (turtle.current_pathing->finished)
+					if (turtle.current_pathing->unable_to_path)
 					{
-						if (turtle.current_pathing->unable_to_path)
-						{
-							//fuck, ask user for help or something
-							continue;
-						}
-						else
+						//fuck, ask user for help or something
+						continue;
+					}
+					else
+					{
+						switch (turtle.value.direction.index())
 						{
-							switch (turtle.value.direction.index())
+						case 0:
+							if (turtle.value.current_action
+							    == TurtleValue::destroy_block)
 							{
-							case 0:
-								if (turtle.value.current_action
-								    == TurtleValue::destroy_block)
-								{
-									turtle.break_block(
-									    std::get<0>(turtle.value.direction));
-								}
-								else if (
-								    turtle.value.current_action
-								    == TurtleValue::place_block)
-								{
-									turtle.place_block(
-									    std::get<0>(turtle.value.direction),
-									    turtle.value.inventory_slot);
-								}
-								else if (
-								    turtle.value.current_action
-								    == TurtleValue::harvest_plant)
+								turtle.break_block(
+								    std::get<0>(turtle.value.direction));
+							}
+							else if (
+							    turtle.value.current_action
+							    == TurtleValue::place_block)
+							{
+								turtle.place_block(
+								    std::get<0>(turtle.value.direction),
+								    turtle.value.inventory_slot);
+							}
+							else if (
+							    turtle.value.current_action
+							    == TurtleValue::harvest_plant)
+							{
+								if (world.server_settings[server_name]
+								        .right_click_harvest)
 								{
-									if (world.server_settings[server_name]
-									        .right_click_harvest)
+									auto slot = find_item_slot(
+									    turtle,
+									    "minecraft:stick");
+									if (slot)
 									{
-										auto slot = find_item_slot(
-										    turtle,
-										    "minecraft:stick");
-										if (slot)
-										{
-											turtle.place_block(
-											    std::get<0>(
-											        turtle.value.direction),
-											    *slot);
-										}
-										else
-										{
-											turtle.break_block(std::get<0>(
-											    turtle.value.direction));
-										}
+										turtle.place_block(
+										    std::get<0>(
+										        turtle.value.direction),
+										    *slot);
 									}
 									else
 									{
-										turtle.break_block(
-										    std::get<0>(turtle.value.direction));
+										turtle.break_block(std::get<0>(
+										    turtle.value.direction));
 									}
 								}
-
-								break;
-							case 1:
-								if (turtle.value.current_action
-								    == TurtleValue::destroy_block)
-								{
-									turtle.break_block_up();
-								}
-								else if (
-								    turtle.value.current_action
-								    == TurtleValue::place_block)
+								else
 								{
-									turtle.place_block_up(
-									    turtle.value.inventory_slot);
+									turtle.break_block(
+									    std::get<0>(turtle.value.direction));
 								}
-								else if (
-								    turtle.value.current_action
-								    == TurtleValue::harvest_plant)
+							}
+
+							break;
+						case 1:
+							if (turtle.value.current_action
+							    == TurtleValue::destroy_block)
+							{
+								turtle.break_block_up();
+							}
+							else if (
+							    turtle.value.current_action
+							    == TurtleValue::place_block)
+							{
+								turtle.place_block_up(
+								    turtle.value.inventory_slot);
+							}
+							else if (
+							    turtle.value.current_action
+							    == TurtleValue::harvest_plant)
+							{
+								if (world.server_settings[server_name]
+								        .right_click_harvest)
 								{
-									if (world.server_settings[server_name]
-									        .right_click_harvest)
+									auto slot = find_item_slot(
+									    turtle,
+									    "minecraft:stick");
+									if (slot)
 									{
-										auto slot = find_item_slot(
-										    turtle,
-										    "minecraft:stick");
-										if (slot)
-										{
-											turtle.place_block_up(*slot);
-										}
-										else
-										{
-											turtle.break_block_up();
-										}
+										turtle.place_block_up(*slot);
 									}
 									else
 									{
 										turtle.break_block_up();
 									}
 								}
-								break;
-							case 2:
-								if (turtle.value.current_action
-								    == TurtleValue::destroy_block)
+								else
 								{
-									turtle.break_block_down();
-								}
-								else if (
-								    turtle.value.current_action
-								    == TurtleValue::place_block)
-								{
-									turtle.place_block_down(
-									    turtle.value.inventory_slot);
+									turtle.break_block_up();
 								}
-								else if (
-								    turtle.value.current_action
-								    == TurtleValue::harvest_plant)
+							}
+							break;
+						case 2:
+							if (turtle.value.current_action
+							    == TurtleValue::destroy_block)
+							{
+								turtle.break_block_down();
+							}
+							else if (
+							    turtle.value.current_action
+							    == TurtleValue::place_block)
+							{
+								turtle.place_block_down(
+								    turtle.value.inventory_slot);
+							}
+							else if (
+							    turtle.value.current_action
+							    == TurtleValue::harvest_plant)
+							{
+								if (world.server_settings[server_name]
+								        .right_click_harvest)
 								{
-									if (world.server_settings[server_name]
-									        .right_click_harvest)
+									auto slot = find_item_slot(
+									    turtle,
+									    "minecraft:stick");
+									if (slot)
 									{
-										auto slot = find_item_slot(
-										    turtle,
-										    "minecraft:stick");
-										if (slot)
-										{
-											turtle.place_block_down(*slot);
-										}
-										else
-										{
-											turtle.break_block_down();
-										}
+										turtle.place_block_down(*slot);
 									}
 									else
 									{
 										turtle.break_block_down();
 									}
 								}
-								break;
-							}
-							turtle.current_pathing = std::nullopt;
-							if (turtle.value.current_action
-							    == TurtleValue::harvest_plant)
-							{
-								turtle.value.where += glm::ivec3{0, 1, 0};
-								switch (turtle.value.direction.index())
+								else
 								{
-								case 0:
-									turtle.value.where
-									    += -direction_to_orientation(
-									        std::get<0>(turtle.value.direction));
-									break;
-								case 1:
-									turtle.value.where += glm::ivec3{0,1,0};
-									break;
-								case 2:
-									turtle.value.where += glm::ivec3{0,-1,0};
-									break;
+									turtle.break_block_down();
 								}
-								turtle.value.current_offset
-								    = glm::ivec3{-1, 0, -1};
-								turtle.value.current_action
-								    = TurtleValue::picking_up_plant_drops;
 							}
-							else
-							{
-								turtle.value.current_action = std::nullopt;
-							}
-						}
-					}
-				}
-			}
-			else if (
-			    turtle.value.current_action
-			    == TurtleValue::picking_up_plant_drops)
-			{
-				if (turtle.current_pathing == std::nullopt)
-				{
-					turtle.current_pathing = Pathing{
-					    turtle.value.where + turtle.value.current_offset,
-					    turtle,
-					    world.make_turtle_allow_mining_obstacle_function(
-					        turtle)};
-				}
-				else if (turtle.current_pathing->finished)
-				{
-					if (turtle.current_pathing->unable_to_path)
-					{
-						continue;
-					}
-					else
-					{
-						auto con = turtle.connection.lock();
-
-						con->pickup_item("down");
-
-						turtle.value.current_offset.x++;
-						if (turtle.value.current_offset.x >= 2)
-						{
-							turtle.value.current_offset.x = -1;
-							turtle.value.current_offset.z++;
-						}
-						if (turtle.value.current_offset.z >= 2)
-						{
-							turtle.value.current_action = std::nullopt;
-						}
-						else
-						{
-							turtle.current_pathing = Pathing{
-							    turtle.value.where + turtle.value.current_offset,
-							    turtle,
-							    world.make_turtle_allow_mining_obstacle_function(
-							        turtle)};
-						}
-					}
-				}
-			}
-			else if (turtle.value.current_action == TurtleValue::checking_block)
-			{
-				if (turtle.current_pathing == std::nullopt)
-				{
-					turtle.current_pathing = Pathing{
-					    turtle.value.where + turtle.value.current_offset,
-					    turtle,
-					    world.make_turtle_allow_mining_obstacle_function(
-					        turtle)};
-				}
-				else if (turtle.current_pathing->finished)
-				{
-					if (turtle.current_pathing->unable_to_path)
-					{
-						if ((turtle.value.current_offset.x
-						     + turtle.value.current_offset.y
-						     + turtle.value.current_offset.z)
-						    == -1)
-						{
-							turtle.value.current_offset *= -1;
-							turtle.current_pathing = Pathing{
-							    turtle.value.where + turtle.value.current_offset,
-							    turtle,
-							    world.make_turtle_allow_mining_obstacle_function(
-							        turtle)};
+							break;
 						}
-						else
+						turtle.replace_pathing();
+						if (turtle.value.current_action
+						    == TurtleValue::harvest_plant)
 						{
-							if (turtle.value.current_offset.y)
-							{
-								turtle.value.current_offset
-								    = glm::ivec3{-1, 0, 0};
-								turtle.current_pathing = Pathing{
-								    turtle.value.where
-								        + turtle.value.current_offset,
-								    turtle,
-								    world
-								        .make_turtle_allow_mining_obstacle_function(
-								            turtle)};
-							}
-							else if (turtle.value.current_offset.x)
-							{
-								turtle.value.current_offset
-								    = glm::ivec3{0, 0, -1};
-								turtle.current_pathing = Pathing{
-								    turtle.value.where
-								        + turtle.value.current_offset,
-								    turtle,
-								    world
-								        .make_turtle_allow_mining_obstacle_function(
-								            turtle)};
-							}
-							else
+							turtle.value.where += glm::ivec3{0, 1, 0};
+							switch (turtle.value.direction.index())
 							{
-								//unable to get to block
-								continue;
+							case 0:
+								turtle.value.where
+								    += -direction_to_orientation(
+								        std::get<0>(turtle.value.direction));
+								break;
+							case 1:
+								turtle.value.where += glm::ivec3{0,1,0};
+								break;
+							case 2:
+								turtle.value.where += glm::ivec3{0,-1,0};
+								break;
 							}
+							turtle.value.current_offset
+							    = glm::ivec3{-1, 0, -1};
+							turtle.value.current_action
+							    = TurtleValue::picking_up_plant_drops;
 						}
-					}
-					else
-					{
-						if (turtle.value.current_offset.y == 0)
-						{
-							turtle.point(orientation_to_direction(
-							    -turtle.value.current_offset));
-						}
-						turtle.value.current_action = std::nullopt;
-						auto &block = world.m_blocks.at(
-						    server_name)[turtle.position.dimension]
-						                [turtle.position.position.x]
-						                [turtle.position.position.y]
-						                [turtle.position.position.z];
-						if (block.value)
+						else
 						{
-							block.value->is_being_checked = true;
-							block.value->last_check
-							    = std::chrono::steady_clock::now();
+							turtle.value.current_action = std::nullopt;
 						}
 					}
 				}
 			}
 		}
-		//find blocks in world that need to be rechecked
-		for (auto &dimension : world.m_blocks.at(server_name))
+		else if (
+		    turtle.value.current_action
+		        == TurtleValue::picking_up_plant_drops
+		    && !turtle.value.task)
 		{
-			for (auto &x : dimension.second)
-			{
-				for (auto &y : x.second)
-				{
-					for (auto &z : y.second)
-					{
-						if (z.second.value)
-						{
-							if (z.second.value->last_check
-							            - std::chrono::steady_clock::now()
-							        > z.second.value->check_every
-							    && !z.second.value->is_being_checked)
-							{
-								//oh boi it's recheck time
-								auto turtle_opt = find_closest_turtle(
-								    z.second.position.position,
-								    z.second.value->associated_jobs,
-								    world,
-								    server_name,
-								    dimension.first);
-								if (turtle_opt)
-								{
-									auto &turtle = turtle_opt->get();
-									turtle.value.current_action
-									    = TurtleValue::checking_block;
-									turtle.value.where
-									    = glm::ivec3{x.first, y.first, z.first};
-									turtle.value.current_offset
-									    = glm::ivec3{0, -1, 0};
-									z.second.value->is_being_checked = true;
-								}
-							}
-							if ((z.second.value->use & BlockValue::FarmingSeed)
-							    && world.server_settings[server_name]
-							           .seed_maturity.contains(z.second.name))
-							{
-								if (z.second.blockstate["age"]
-								    >= world.server_settings[server_name]
-								           .seed_maturity[z.second.name])
-								{
-									auto turtle_opt = find_closest_turtle(
-									    z.second.position,
-									    TurtleValue::FARMER,
-									    world);
-									if (turtle_opt)
-									{
-										auto &turtle = turtle_opt->get();
-										turtle.value.current_action
-										    = TurtleValue::harvest_plant;
-										turtle.value.where
-										    = z.second.position.position;
-										turtle.value.direction = std::variant<
-										    Direction,
-										    std::monostate,
-										    std::monostate>{
-										    std::in_place_index<2>};
-									}
-								}
-							}
-						}
-					}
-				}
-			}
+			turtle.value.task = pick_up_plant_drops(world, turtle.name);
+		}
+		else if (
+		    turtle.value.current_action == TurtleValue::checking_block
+		    && !turtle.value.task)
+		{
+			turtle.value.task = check_block(world, turtle.name);
 		}
 	}
+	//then whatever came due since the last step
+	assign_due_blocks(
+	    world,
+	    server_name,
+	    world.block_scheduler_for(server_name)
+	        .pop_due(std::chrono::steady_clock::now()));
 }
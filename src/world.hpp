@@ -1,6 +1,10 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <deque>
+#include <limits>
 #include <map>
 #include <mutex>
 #include <string>
@@ -21,6 +25,18 @@
 #include "nlohmann/json.hpp"
 
 #include "AStar.hpp"
+#include "BidirectionalAStar.hpp"
+#include "BlockScheduler.hpp"
+#include "CooperativeAStar.hpp"
+#include "JumpPointSearch.hpp"
+#include "Metrics.hpp"
+#include "ReservationTable.hpp"
+#include "RouteCache.hpp"
+#include "TourPlanner.hpp"
+#include "TurtleIndex.hpp"
+#include "TurtleTask.hpp"
+#include "ValueIndex.hpp"
+#include "WorldExecutor.hpp"
 
 #include "Computer.hpp"
 #include "Server.hpp"
@@ -140,22 +156,61 @@ struct Item
 struct Turtle;
 class World;
 
+// how far a turtle got through a route sent as one command buffer
+struct RouteProgress
+{
+	int steps_completed = 0;
+	bool aborted = false;
+};
+
 struct Pathing
 {
-	Pathing(glm::ivec3 _target, Turtle &turtle, World &world);
 	Pathing(
 	    glm::ivec3 _target,
 	    Turtle &turtle,
-	    std::function<bool(glm::ivec3)> obstacle);
-	std::unique_ptr<AStar> pather;
-	boost::future<bool> result;
+	    World &world,
+	    PlannerKind kind = PlannerKind::astar,
+	    ObstacleKind obstacles = ObstacleKind::normal);
+	void start(glm::ivec3 from);
+	PlannerKind kind = PlannerKind::astar;
+	ObstacleKind obstacles = ObstacleKind::normal;
+	bool cacheable = false;
+	std::function<std::unique_ptr<Planner>(glm::ivec3)> make_pather;
+	// shared with the search so it outlives a Pathing that is replaced while
+	// searching
+	std::shared_ptr<Planner> pather;
+	// tells the world a search is done, from the search's thread
+	std::function<void(uint64_t step, bool found)> report_search;
 	glm::ivec3 target;
 	std::vector<glm::ivec3> latest_results;
 	int movement_index
 	    = 0; // latest movement in latest_results that has been done
-	std::optional<boost::future<nlohmann::json>> pending_movement;
+	// what the pathing waits for now, a search or a route. a reply for any
+	// other step is for a search or route that was replaced and is dropped
+	uint64_t step = 0;
+	inline static std::atomic<uint64_t> next_step = 1;
 	bool finished = false;
 	bool unable_to_path = false;
+	// the step latest_results[0] is reserved at, for cooperative pathing
+	int reserved_from = 0;
+	// partial results that ended no closer to the target than the closest
+	// one before them
+	int windows_without_progress = 0;
+	int closest_distance = std::numeric_limits<int>::max();
+	// called once when the pathing finishes, with whether it got there
+	std::function<void(bool reached)> on_finished;
+
+	void finish(bool unable = false)
+	{
+		finished = true;
+		unable_to_path = unable;
+		if (on_finished)
+		{
+			auto notify = std::move(on_finished);
+			on_finished = nullptr;
+			notify(!unable);
+		}
+	}
 };
 
 struct TurtleValue
@@ -182,6 +237,12 @@ struct TurtleValue
 	glm::ivec3 current_offset;
 	std::variant<Direction, std::monostate, std::monostate> direction;
 	int inventory_slot;
+	// plants still to harvest after the current one, in tour order. not
+	// saved, they come due again after a restart and get a new tour
+	std::deque<glm::ivec3> queued_harvests;
+	// the script running current_action, for actions that have one. not
+	// saved, a loaded action starts its script over
+	std::optional<TurtleTask> task;
 
 	private:
 	friend class boost::serialization::access;
@@ -205,9 +266,23 @@ struct Turtle
 	std::array<std::optional<Item>, 16> inventory;
 	std::chrono::steady_clock::time_point last_inventory_get
 	    = std::chrono::steady_clock::now() - 24h;
-	std::optional<boost::future<decltype(inventory)>> current_inventory_get;
+	bool inventory_get_underway = false;
+	// sent changes to its inventory by itself since it connected, so it is
+	// only asked for all of it now and then to catch anything that got lost
+	bool inventory_pushed = false;
 	TurtleValue value;
 
+	// the search of the pathing it had is stopped, one for a target that
+	// can't be reached would otherwise never end
+	void replace_pathing(std::optional<Pathing> pathing = std::nullopt)
+	{
+		if (current_pathing && current_pathing->pather)
+		{
+			current_pathing->pather->stop = true;
+		}
+		current_pathing = std::move(pathing);
+	}
+
 	void move(Direction direction)
 	{
 		if (!connection.expired())
@@ -870,6 +945,8 @@ struct ServerSettings
 	                               //the farmland becomes dirt
 	std::unordered_map<std::string, int>
 	    seed_maturity; //the growth level where a seed is mature
+	bool cooperative_pathing
+	    = true; // automation plans around other turtles' reserved paths
 
 	private:
 	friend class boost::serialization::access;
@@ -880,9 +957,33 @@ struct ServerSettings
 		ar &plant_drops;
 		ar &blocks_to_not_be_ontop_of;
 		ar &seed_maturity;
+		if (version >= 1)
+		{
+			ar &cooperative_pathing;
+		}
 	}
 };
 
+BOOST_CLASS_VERSION(ServerSettings, 1)
+
+// whether a farmed seed has grown as far as the server says it needs to. looks
+// without operator[] so blocks that have no age don't get one
+inline bool crop_is_mature(const Block &block, const ServerSettings &settings)
+{
+	if (!block.value || !(block.value->use & BlockValue::FarmingSeed))
+	{
+		return false;
+	}
+	auto maturity = settings.seed_maturity.find(block.name);
+	if (maturity == settings.seed_maturity.end())
+	{
+		return false;
+	}
+	auto age = block.blockstate.find("age");
+	return age != block.blockstate.end() && age->is_number()
+	       && age->get<int>() >= maturity->second;
+}
+
 class World
 {
 	friend class boost::serialization::access;
@@ -929,29 +1030,43 @@ class World
 		inventory_get_buffer.inventory();
 		inventory_get_buffer.SupplyOutputParser(
 		    [](nlohmann::json result) -> decltype(Turtle::inventory) {
-			    decltype(Turtle::inventory) inventory;
-			    auto items = result.at(0);
-			    for (size_t i = 1; i < 16; i++)
-			    {
-				    if (items[i].is_null())
-				    {
-					    inventory[i] = std::nullopt;
-				    }
-				    else
-				    {
-					    inventory[i] = Item{};
-					    inventory[i]->name = items[i].at("name");
-					    inventory[i]->amount = items[i].at("count");
-					    inventory[i]->damage = items[i].at("damage");
-				    }
-			    }
-			    return inventory;
+			    return inventory_from_JSON(result.at(0));
 		    });
 	}
 
-	void update_block_from_JSON(ComputerInterface &a, nlohmann::json blocks)
+	// the reply to an inventory request, slot 1 first like the deltas in
+	// update_inventory_from_JSON count them
+	static decltype(Turtle::inventory)
+	inventory_from_JSON(const nlohmann::json &items)
+	{
+		decltype(Turtle::inventory) inventory;
+		for (size_t i = 0; i < inventory.size() && i < items.size(); i++)
+		{
+			inventory[i] = item_from_JSON(items[i]);
+		}
+		return inventory;
+	}
+
+	// a slot as the turtle reports it, null when empty
+	static std::optional<Item> item_from_JSON(const nlohmann::json &item)
+	{
+		if (item.is_null())
+		{
+			return std::nullopt;
+		}
+		Item parsed;
+		parsed.name = item.at("name");
+		parsed.amount = item.at("count");
+		parsed.damage = item.at("damage");
+		return parsed;
+	}
+
+	void update_block_from_JSON(nlohmann::json blocks)
 	{
-		std::scoped_lock lock{render_mutex};
+		static auto &ingested = metrics().counter(
+		    "controller_blocks_ingested_total",
+		    "blocks turtles reported");
+		ingested.add(blocks.size());
 		for (auto &block : blocks)
 		{
 			std::pair<std::optional<Block>, WorldLocation> parsed_block;
@@ -987,12 +1102,12 @@ class World
 		}
 	}
 	void update_turtle_from_JSON(
-	    ComputerInterface &turtle_connection,
+	    const ComputerInterface *turtle_connection,
 	    nlohmann::json position)
 	{
 		for (auto &turtle : m_turtles)
 		{
-			if (turtle.connection.lock().get() == &turtle_connection)
+			if (turtle.connection.lock().get() == turtle_connection)
 			{
 				turtle.position.position.x = position.at("x").get<int>();
 				turtle.position.position.y = position.at("y").get<int>();
@@ -1002,11 +1117,45 @@ class World
 				    = position.at("dimension").get<std::string>();
 				turtle.position.server
 				    = position.at("server").get<std::string>();
+				index_turtle(&turtle - m_turtles.data());
 			}
 		}
 		dirty_renderer();
 	}
 
+	// slots that changed, as [{"slot": 1-16, "item": item or null}], sent by
+	// the turtle on its turtle_inventory event. they come over the same
+	// connection as the replies, so a full inventory asked for before they
+	// happened is never put in after them
+	void update_inventory_from_JSON(
+	    const ComputerInterface *turtle_connection,
+	    nlohmann::json changes)
+	{
+		static auto &deltas = metrics().counter(
+		    "controller_inventory_deltas_total",
+		    "inventory slot changes turtles sent by themselves");
+		deltas.add(changes.size());
+		for (auto &turtle : m_turtles)
+		{
+			if (turtle.connection.lock().get() != turtle_connection)
+			{
+				continue;
+			}
+			for (auto &change : changes)
+			{
+				auto slot = change.at("slot").get<int>() - 1;
+				if (slot < 0 || slot >= static_cast<int>(turtle.inventory.size()))
+				{
+					continue;
+				}
+				turtle.inventory[slot] = item_from_JSON(change.at("item"));
+			}
+			turtle.inventory_pushed = true;
+		}
+	}
+
+	// only a block that appears, goes away or changes moves its chunk's
+	// version, turtles scan the same blocks over and over along their routes
 	void update_block(std::pair<std::optional<Block>, WorldLocation> block)
 	{
 		if (block.first)
@@ -1016,13 +1165,54 @@ class World
 			{
 				return;
 			}
-			m_blocks[block.second.server][block.second.dimension]
-			        [block.second.position.x][block.second.position.y]
-			        [block.second.position.z]
-			    = *(block.first);
+			bool appeared = !block_at(
+			    block.second.server,
+			    block.second.dimension,
+			    block.second.position);
+			auto &stored = m_blocks[block.second.server][block.second.dimension]
+			                       [block.second.position.x]
+			                       [block.second.position.y]
+			                       [block.second.position.z];
+			bool state_changed = appeared || stored.name != block.first->name
+			                     || stored.blockstate != block.first->blockstate;
+			if (state_changed)
+			{
+				touch_chunk(block.second);
+			}
+			bool was_mature = state_changed && is_mature(stored);
+			// what the block is for is ours, not the turtle's
+			if (!block.first->value)
+			{
+				block.first->value = std::move(stored.value);
+				stored = *(block.first);
+			}
+			else
+			{
+				unindex_value(stored);
+				stored = *(block.first);
+				index_value(stored);
+			}
+			// a crop that just grew up is due now instead of at its next
+			// recheck
+			if (state_changed && !was_mature && is_mature(stored))
+			{
+				block_scheduler_for(block.second.server)
+				    .schedule(
+				        block.second.dimension,
+				        block.second.position,
+				        std::chrono::steady_clock::now());
+			}
 		}
 		else
 		{
+			if (auto old = block_at(
+			        block.second.server,
+			        block.second.dimension,
+			        block.second.position))
+			{
+				unindex_value(*old);
+				touch_chunk(block.second);
+			}
 			erase_nested(
 			    m_blocks,
 			    block.second.server,
@@ -1037,23 +1227,231 @@ class World
 		}
 	}
 
-	void update_data_gets()
+	void erase_block(WorldLocation location)
+	{
+		if (auto old
+		    = block_at(location.server, location.dimension, location.position))
+		{
+			unindex_value(*old);
+		}
+		erase_nested(
+		    m_blocks,
+		    location.server,
+		    location.dimension,
+		    location.position.x,
+		    location.position.y,
+		    location.position.z);
+		touch_chunk(location);
+		if (dirty_renderer)
+		{
+			dirty_renderer();
+		}
+	}
+
+	// gives a block a job (or takes it away), blocks with a value get
+	// rechecked every check_every
+	void set_block_value(
+	    const WorldLocation &location,
+	    std::optional<BlockValue> value)
+	{
+		auto block
+		    = block_at(location.server, location.dimension, location.position);
+		if (!block)
+		{
+			return;
+		}
+		unindex_value(*block);
+		block->get().value = std::move(value);
+		index_value(*block);
+		if (block->get().value)
+		{
+			schedule_recheck(block->get());
+		}
+		else
+		{
+			block_scheduler_for(location.server)
+			    .cancel(location.dimension, location.position);
+		}
+	}
+
+	void index_value(const Block &block)
+	{
+		if (block.value)
+		{
+			value_index.add(
+			    block.position.server,
+			    block.position.dimension,
+			    block.position.position,
+			    block.value->use,
+			    block.value->associated_jobs);
+		}
+	}
+	void unindex_value(const Block &block)
+	{
+		if (block.value)
+		{
+			value_index.remove(
+			    block.position.server,
+			    block.position.dimension,
+			    block.position.position,
+			    block.value->use,
+			    block.value->associated_jobs);
+		}
+	}
+
+	void index_turtle(size_t index)
+	{
+		auto &position = m_turtles[index].position;
+		turtle_index.update(
+		    index,
+		    position.server,
+		    position.dimension,
+		    position.position);
+	}
+	// the index goes by position in m_turtles, so everything after the
+	// removed turtle moves down one
+	void remove_turtle(size_t index)
+	{
+		m_turtles.erase(m_turtles.begin() + index);
+		reindex_turtles();
+	}
+	void reindex_turtles()
+	{
+		turtle_index.clear();
+		for (size_t i = 0; i < m_turtles.size(); i++)
+		{
+			index_turtle(i);
+		}
+	}
+
+	BlockScheduler &block_scheduler_for(const std::string &server)
+	{
+		std::scoped_lock a{m_block_scheduler_mutex};
+		return m_block_schedulers[server];
+	}
+
+	bool is_mature(const Block &block)
+	{
+		auto settings = server_settings.find(block.position.server);
+		return settings != server_settings.end()
+		       && crop_is_mature(block, settings->second);
+	}
+
+	constexpr static std::chrono::seconds min_recheck_interval{1};
+
+	void schedule_recheck(const Block &block)
+	{
+		if (!block.value)
+		{
+			return;
+		}
+		auto every = std::max<std::chrono::duration<double>>(
+		    block.value->check_every,
+		    min_recheck_interval);
+		block_scheduler_for(block.position.server)
+		    .schedule(
+		        block.position.dimension,
+		        block.position.position,
+		        block.value->last_check
+		            + std::chrono::duration_cast<
+		                std::chrono::steady_clock::duration>(every));
+	}
+
+	// hands what a future resolves to over to whoever owns the world the
+	// moment it resolves, nullopt if it threw. the handler runs like anything
+	// else posted to the executor. posting happens on the thread resolving
+	// the future, so replies are posted in the order they arrived
+	template <typename T, typename Handler>
+	void when_ready(boost::future<T> future, Handler handler)
+	{
+		future.then(
+		    boost::launch::sync,
+		    [this, handler](boost::future<T> done) {
+			    std::optional<T> value;
+			    try
+			    {
+				    value = done.get();
+			    }
+			    catch (...)
+			    {
+				    static auto &failures = metrics().counter(
+				        "controller_turtle_request_failures_total",
+				        "requests whose future threw instead of replying");
+				    failures.add();
+			    }
+			    executor.post([handler, value = std::move(value)]() {
+				    handler(value);
+			    });
+		    });
+	}
+
+	// for server_manager::broadcast, the turtles connected now on server, in
+	// dimension and with one of jobs. empty names and no jobs match anything
+	ComputerFilter turtle_filter(
+	    const std::string &server = "",
+	    const std::string &dimension = "",
+	    int jobs = 0)
+	{
+		std::unordered_set<const ComputerInterface *> matching;
+		for (auto &turtle : m_turtles)
+		{
+			auto connection = turtle.connection.lock();
+			if (connection
+			    && (server.empty() || turtle.position.server == server)
+			    && (dimension.empty() || turtle.position.dimension == dimension)
+			    && (jobs == 0 || (turtle.value.job & jobs) != 0))
+			{
+				matching.insert(connection.get());
+			}
+		}
+		return [matching = std::move(matching)](
+		           const ComputerInterface &computer) {
+			return matching.contains(&computer);
+		};
+	}
+
+	// turtles are looked up by name once a reply comes in, the one that
+	// asked may have been removed or moved in m_turtles since
+	Turtle *turtle_named(const std::string &name)
 	{
-		std::scoped_lock<std::mutex> a{render_mutex};
 		for (auto &turtle : m_turtles)
 		{
-			if (turtle.current_inventory_get
-			    && turtle.current_inventory_get->is_ready())
+			if (turtle.name == name)
 			{
-				turtle.inventory = turtle.current_inventory_get->get();
-				turtle.current_inventory_get = std::nullopt;
+				return &turtle;
 			}
 		}
+		return nullptr;
+	}
+
+	void expect_inventory(
+	    Turtle &turtle,
+	    boost::future<decltype(Turtle::inventory)> inventory)
+	{
+		turtle.inventory_get_underway = true;
+		turtle.last_inventory_get = std::chrono::steady_clock::now();
+		when_ready(
+		    std::move(inventory),
+		    [this, name = turtle.name](
+		        std::optional<decltype(Turtle::inventory)> inventory) {
+			    if (auto turtle = turtle_named(name))
+			    {
+				    if (inventory)
+				    {
+					    turtle->inventory = *inventory;
+				    }
+				    turtle->inventory_get_underway = false;
+			    }
+		    });
 	}
 
+	// how often a turtle is asked for its whole inventory, turtles that send
+	// their own changes only need it to catch ones that got lost
+	constexpr static std::chrono::seconds inventory_poll_interval{5};
+	constexpr static std::chrono::seconds inventory_reconcile_interval{60};
+
 	void get_data_from_turtles()
 	{
-		std::scoped_lock a{render_mutex};
 		for (auto &turtle : m_turtles)
 		{
 			// TODO: add a timer so turtles aren't spammed, maybe make a timer
@@ -1064,222 +1462,494 @@ class World
 				    = static_cast<std::shared_ptr<ComputerInterface>>(
 				        turtle.connection);
 
-				if (turtle.current_inventory_get == std::nullopt
+				auto interval = turtle.inventory_pushed
+				                    ? inventory_reconcile_interval
+				                    : inventory_poll_interval;
+				if (!turtle.inventory_get_underway
 				    && std::chrono::steady_clock::now()
 				               - turtle.last_inventory_get
-				           > 5s)
+				           > interval)
 				{
-					turtle.current_inventory_get
-					    = turtle_connection->execute_buffer_future(
-					        inventory_get_buffer);
-					turtle.last_inventory_get = std::chrono::steady_clock::now();
+					RequestLaneScope background{RequestLane::background};
+					expect_inventory(
+					    turtle,
+					    turtle_connection->execute_buffer_future(
+					        inventory_get_buffer));
 				}
 			}
 		}
 	}
 
+	// called on the network thread, the world only hears about it through
+	// the executor
 	void new_turtle(std::shared_ptr<ComputerInterface> turtle)
 	{
-		std::scoped_lock a{render_mutex};
 		turtle->set_unexpected_message_handler(
-		    std::bind(
-		        &World::update_block_from_JSON,
-		        this,
-		        std::placeholders::_1,
-		        std::placeholders::_2),
+		    [this](ComputerInterface &, nlohmann::json blocks) {
+			    executor.post([this, blocks = std::move(blocks)]() {
+				    update_block_from_JSON(blocks);
+			    });
+		    },
 		    -1);
 		turtle->set_unexpected_message_handler(
-		    std::bind(
-		        &World::update_turtle_from_JSON,
-		        this,
-		        std::placeholders::_1,
-		        std::placeholders::_2),
+		    [this](ComputerInterface &connection, nlohmann::json position) {
+			    executor.post([this,
+			                   connection = &connection,
+			                   position = std::move(position)]() {
+				    update_turtle_from_JSON(connection, position);
+			    });
+		    },
 		    -2);
-		m_turtles_in_progress.push_back(
-		    {turtle, turtle->execute_buffer_future(position_and_name)});
+		turtle->set_unexpected_message_handler(
+		    [this](ComputerInterface &connection, nlohmann::json changes) {
+			    executor.post([this,
+			                   connection = &connection,
+			                   changes = std::move(changes)]() {
+				    update_inventory_from_JSON(connection, changes);
+			    });
+		    },
+		    -3);
+		when_ready(
+		    turtle->execute_buffer_future(position_and_name),
+		    [this, turtle](auto position_and_name) {
+			    if (position_and_name && *position_and_name)
+			    {
+				    add_turtle(turtle, **position_and_name);
+			    }
+		    });
 		turtle->auth_message("welcome");
 		std::cout << "new turtle\n";
 	}
 
-	void add_new_turtles()
+	void add_turtle(
+	    std::shared_ptr<ComputerInterface> connection,
+	    std::pair<WorldLocation, std::optional<nlohmann::json>>
+	        position_and_name)
 	{
-		std::scoped_lock a{render_mutex};
-		bool turtles_added = false;
-		for (size_t i = m_turtles_in_progress.size(); i != 0; i--)
+		auto position = position_and_name.first;
+		auto info = position_and_name.second;
+		std::string label;
+		if (info)
 		{
-			auto &turtle = m_turtles_in_progress[i - 1];
-			turtles_added = true;
-			if (turtle.second.is_ready())
+			label = info->get<std::string>();
+		}
+		else
+		{
+			label = hash(connection);
+		}
+		std::cout << "adding computer with label " << label << " to world\n";
+		bool found = false;
+		for (auto &check_turtle : m_turtles)
+		{
+			if (check_turtle.name == label)
 			{
-				auto position_and_name_opt = turtle.second.get();
-				if (!position_and_name_opt.has_value())
-				{
-					m_turtles_in_progress.erase(
-					    m_turtles_in_progress.begin() + i - 1);
-					continue;
-				}
-				auto position_and_name = *position_and_name_opt;
-				auto position = position_and_name.first;
-				auto info = position_and_name.second;
-				std::string label;
-				if (info)
-				{
-					label = info->get<std::string>();
-				}
-				else
-				{
-					label = hash(turtle.first);
-				}
-				std::cout << "adding computer with label " << label
-				          << " to world\n";
-				bool found = false;
-				for (auto &check_turtle : m_turtles)
-				{
-					if (check_turtle.name == label)
-					{
-						std::cout << "found turtle already in world\n";
-						check_turtle.connection = turtle.first;
-						check_turtle.position.position = position.position;
-						check_turtle.position.direction = position.direction;
-						check_turtle.position.server = position.server;
-						check_turtle.position.dimension = position.dimension;
-						found = true;
-						break;
-					}
-				}
-				if (!found)
-				{
-					std::cout << "creating new turtle in world\n";
-					Turtle new_turtle;
-					new_turtle.connection = turtle.first;
-					std::string name = std::to_string(hash(turtle.first));
-					new_turtle.name = name;
-					turtle.first->remote_eval(
-					    "os.setComputerLabel(\"" + name + "\")");
-					new_turtle.position.position = position.position;
-					new_turtle.position.direction = position.direction;
-					new_turtle.position.server = position.server;
-					new_turtle.position.dimension = position.dimension;
-					m_turtles.push_back(std::move(new_turtle));
-				}
-				m_turtles_in_progress.erase(
-				    m_turtles_in_progress.begin() + i - 1);
+				std::cout << "found turtle already in world\n";
+				check_turtle.connection = connection;
+				check_turtle.inventory_pushed = false;
+				check_turtle.position.position = position.position;
+				check_turtle.position.direction = position.direction;
+				check_turtle.position.server = position.server;
+				check_turtle.position.dimension = position.dimension;
+				index_turtle(&check_turtle - m_turtles.data());
+				found = true;
+				break;
 			}
 		}
-		if (turtles_added && dirty_renderer)
+		if (!found)
 		{
-			dirty_renderer();
+			std::cout << "creating new turtle in world\n";
+			Turtle new_turtle;
+			new_turtle.connection = connection;
+			std::string name = std::to_string(hash(connection));
+			new_turtle.name = name;
+			connection->remote_eval("os.setComputerLabel(\"" + name + "\")");
+			new_turtle.position.position = position.position;
+			new_turtle.position.direction = position.direction;
+			new_turtle.position.server = position.server;
+			new_turtle.position.dimension = position.dimension;
+			m_turtles.push_back(std::move(new_turtle));
+			index_turtle(m_turtles.size() - 1);
 		}
+		dirty_renderer();
 	}
 
-	void update_pathings()
+	void update_reservations()
 	{
-		std::scoped_lock<std::mutex> a{render_mutex};
+		auto now = std::chrono::steady_clock::now();
+		for (auto &server : m_reservations)
+		{
+			for (auto &dimension : server.second)
+			{
+				dimension.second.advance(now);
+			}
+		}
 		for (auto &turtle : m_turtles)
 		{
-			if (turtle.current_pathing && !turtle.current_pathing->finished)
+			update_reservation(turtle);
+		}
+	}
+
+	// the turtle whose pathing is waiting on step, if it still is
+	Turtle *turtle_waiting_on(const std::string &name, uint64_t step)
+	{
+		auto turtle = turtle_named(name);
+		if (!turtle || !turtle->current_pathing
+		    || turtle->current_pathing->finished
+		    || turtle->current_pathing->step != step)
+		{
+			return nullptr;
+		}
+		return turtle;
+	}
+
+	void search_finished(const std::string &name, uint64_t step, bool found)
+	{
+		auto turtle = turtle_waiting_on(name, step);
+		if (!turtle)
+		{
+			return;
+		}
+		auto &pathing = *turtle->current_pathing;
+		if (!found)
+		{
+			pathing.finish(true);
+		}
+		else if (turtle->position.position == pathing.target)
+		{
+			pathing.finish();
+		}
+		else
+		{
+			pathing.latest_results = pathing.pather->path_result();
+			if (pathing.pather->partial() && !making_progress(pathing))
+			{
+				pathing.finish(true);
+				return;
+			}
+			if (pathing.kind == PlannerKind::cooperative)
 			{
-				if (turtle.current_pathing->pending_movement)
+				pathing.reserved_from
+				    = static_cast<CooperativeAStar &>(*pathing.pather)
+				          .reserved_from();
+			}
+			cache_route(*turtle);
+			dirty_renderer_pathes();
+			start_pathing_route(*turtle);
+		}
+	}
+
+	// waiting is always possible, so a search for a target that can't be
+	// reached still ends at the edge of its window every time
+	constexpr static int max_windows_without_progress = 3;
+	static bool making_progress(Pathing &pathing)
+	{
+		auto difference
+		    = glm::abs(pathing.latest_results.back() - pathing.target);
+		int distance = difference.x + difference.y + difference.z;
+		if (distance < pathing.closest_distance)
+		{
+			pathing.closest_distance = distance;
+			pathing.windows_without_progress = 0;
+			return true;
+		}
+		return ++pathing.windows_without_progress
+		       < max_windows_without_progress;
+	}
+
+	void route_finished(
+	    const std::string &name,
+	    uint64_t step,
+	    RouteProgress progress)
+	{
+		auto turtle = turtle_waiting_on(name, step);
+		if (!turtle)
+		{
+			return;
+		}
+		auto &pathing = *turtle->current_pathing;
+		pathing.movement_index += progress.steps_completed;
+		if (turtle->position.position == pathing.target)
+		{
+			pathing.finish();
+		}
+		else if (progress.aborted || turtle_requires_repath(*turtle))
+		{
+			pathing.start(turtle->position.position);
+			pathing.latest_results.clear();
+			dirty_renderer_pathes();
+			pathing.movement_index = 0;
+		}
+		else
+		{
+			start_pathing_route(*turtle);
+		}
+	}
+
+	// the rest of the path goes out as a single command buffer instead of a
+	// round trip per block, the turtle aborts the buffer at the first failed
+	// move and the result says how many steps it managed
+	constexpr static size_t max_route_length = 32;
+	void start_pathing_route(Turtle &turtle)
+	{
+		auto &pathing = *turtle.current_pathing;
+		// the network thread can drop the computer any time, hold on to it
+		auto connection = turtle.connection.lock();
+		if (!connection || pathing.latest_results.empty())
+		{
+			// nobody to send it to or nothing to send, repathing would only
+			// fail the same way
+			pathing.finish(true);
+			return;
+		}
+		CommandBuffer<RouteProgress> route;
+		route.abort_on_failure();
+		// index of the last path step finished by each command
+		std::vector<int> step_of_command;
+		auto facing = turtle.position.direction;
+		auto first = static_cast<size_t>(pathing.movement_index);
+		auto last = std::min(
+		    pathing.latest_results.size() - 1,
+		    first + max_route_length);
+		for (size_t i = first; i < last; i++)
+		{
+			int step = static_cast<int>(i - first) + 1;
+			auto move_diff
+			    = pathing.latest_results[i + 1] - pathing.latest_results[i];
+			if (move_diff == glm::ivec3{0, 0, 0})
+			{
+				// cooperative paths wait in place to let other turtles pass
+				route.eval(
+				    "os.sleep("
+				    + std::to_string(ReservationTable::step_duration.count())
+				    + ")");
+			}
+			else if (move_diff == glm::ivec3{0, 1, 0})
+			{
+				route.move("up");
+			}
+			else if (move_diff == glm::ivec3{0, -1, 0})
+			{
+				route.move("down");
+			}
+			else
+			{
+				auto direction = orientation_to_direction(move_diff);
+				switch ((static_cast<int>(direction) - static_cast<int>(facing)
+				         + 4)
+				        % 4)
 				{
-					if (turtle.current_pathing->pending_movement->is_ready())
-					{
-						if (turtle_requires_repath(turtle))
-						{
-							turtle.current_pathing->pather
-							    = std::make_unique<AStar>(
-							        turtle.position.position,
-							        turtle.current_pathing->target,
-							        make_turtle_obstacle_function(turtle));
-							turtle.current_pathing->result = boost::async(
-							    &AStar::run,
-							    turtle.current_pathing->pather.get());
-							turtle.current_pathing->pending_movement
-							    = std::nullopt;
-							turtle.current_pathing->latest_results.clear();
-							dirty_renderer_pathes();
-							turtle.current_pathing->movement_index = 0;
-						}
-						else
-						{
-							if (turtle.position.position
-							    == turtle.current_pathing->target)
-							{
-								turtle.current_pathing->finished = true;
-							}
-							else
-							{
-								start_next_pathing_move(turtle);
-							}
-						}
-					}
+				case 1:
+					route.rotate("right");
+					step_of_command.push_back(step - 1);
+					break;
+				case 2:
+					route.rotate("right");
+					step_of_command.push_back(step - 1);
+					route.rotate("right");
+					step_of_command.push_back(step - 1);
+					break;
+				case 3:
+					route.rotate("left");
+					step_of_command.push_back(step - 1);
+					break;
 				}
-				else
+				facing = direction;
+				route.move("forward");
+			}
+			step_of_command.push_back(step);
+		}
+		route.SupplyOutputParser(
+		    [step_of_command](nlohmann::json results) -> RouteProgress {
+			    RouteProgress progress;
+			    if (!results.is_array())
+			    {
+				    progress.aborted = true;
+				    return progress;
+			    }
+			    for (size_t i = 0; i < step_of_command.size(); i++)
+			    {
+				    if (i >= results.size() || command_failed(results[i]))
+				    {
+					    progress.aborted = true;
+					    break;
+				    }
+				    progress.steps_completed = step_of_command[i];
+			    }
+			    return progress;
+		    });
+		pathing.step = Pathing::next_step++;
+		when_ready(
+		    connection->execute_buffer_future(route),
+		    [this, name = turtle.name, step = pathing.step](
+		        std::optional<RouteProgress> progress) {
+			    route_finished(
+			        name,
+			        step,
+			        progress.value_or(RouteProgress{0, true}));
+		    });
+	}
+
+	static bool command_failed(const nlohmann::json &result)
+	{
+		if (!result.is_object())
+		{
+			return false;
+		}
+		if (result.contains("error"))
+		{
+			return true;
+		}
+		if (auto success = result.find("success");
+		    success != result.end() && success->is_boolean())
+		{
+			return !success->get<bool>();
+		}
+		if (auto returns = result.find("returns");
+		    returns != result.end() && returns->is_array() && !returns->empty()
+		    && returns->at(0).is_boolean())
+		{
+			return !returns->at(0).get<bool>();
+		}
+		return false;
+	}
+
+	bool turtle_requires_repath(Turtle &turtle)
+	{
+		auto &pathing = *turtle.current_pathing;
+		// cooperative paths end at the edge of their window, the rest of the
+		// trip is planned from wherever the turtle got to
+		if (static_cast<size_t>(pathing.movement_index + 1)
+		    >= pathing.latest_results.size())
+		{
+			return true;
+		}
+		return pathing.pather->obstacle(
+		           pathing.latest_results[pathing.movement_index + 1])
+		       || turtle.position.position
+		              != pathing.latest_results[pathing.movement_index];
+	}
+
+	void cache_route(Turtle &turtle)
+	{
+		auto &pathing = *turtle.current_pathing;
+		auto &path = pathing.latest_results;
+		if (!pathing.cacheable || path.empty() || path.back() != pathing.target)
+		{
+			return;
+		}
+		// waits only make sense at the time the path was planned
+		std::vector<glm::ivec3> route;
+		std::unique_copy(path.begin(), path.end(), std::back_inserter(route));
+		// made before route is moved from, argument order isn't fixed
+		RouteKey key{
+		    turtle.position.server,
+		    turtle.position.dimension,
+		    route.front(),
+		    pathing.target,
+		    pathing.obstacles};
+		route_cache.store(
+		    key,
+		    std::move(route),
+		    versions_for(turtle.position.server, turtle.position.dimension));
+	}
+
+	RouteCache::version_lookup
+	versions_for(const std::string &server, const std::string &dimension)
+	{
+		return [this, server, dimension](glm::ivec3 chunk) -> uint64_t {
+			return chunk_version(server, dimension, chunk);
+		};
+	}
+
+	uint64_t chunk_version(
+	    const std::string &server,
+	    const std::string &dimension,
+	    glm::ivec3 chunk)
+	{
+		std::scoped_lock a{m_chunk_version_mutex};
+		if (auto s = m_chunk_versions.find(server); s != m_chunk_versions.end())
+		{
+			if (auto d = s->second.find(dimension); d != s->second.end())
+			{
+				if (auto c = d->second.find(chunk); c != d->second.end())
 				{
-					if (turtle.current_pathing->result.is_ready())
-					{
-						auto result = turtle.current_pathing->result.get();
-						if (result)
-						{
-							if (turtle.position.position
-							    == turtle.current_pathing->target)
-							{
-								turtle.current_pathing->finished = true;
-							}
-							else
-							{
-								turtle.current_pathing->latest_results
-								    = turtle.current_pathing->pather
-								          ->path_result();
-								dirty_renderer_pathes();
-								start_next_pathing_move(turtle);
-							}
-						}
-						else
-						{
-							turtle.current_pathing->finished = true;
-							turtle.current_pathing->unable_to_path = true;
-						}
-					}
+					return c->second;
 				}
 			}
 		}
+		return 0;
+	}
+
+	void touch_chunk(const WorldLocation &location)
+	{
+		std::scoped_lock a{m_chunk_version_mutex};
+		m_chunk_versions[location.server][location.dimension]
+		                [chunk_of(location.position)]++;
 	}
 
-	void start_next_pathing_move(Turtle &turtle)
+	ReservationTable &reservations_for(const WorldLocation &location)
 	{
-		auto &mi = turtle.current_pathing->movement_index;
-		auto move_diff = turtle.current_pathing->latest_results[mi + 1]
-		                 - turtle.current_pathing->latest_results[mi];
-		std::cout << "from: "
-		          << glm::to_string(turtle.current_pathing->latest_results[mi])
-		          << "\nto: "
-		          << glm::to_string(
-		                 turtle.current_pathing->latest_results[mi + 1])
-		          << "\ndelta: " << glm::to_string(move_diff) << '\n';
-		if (move_diff == glm::ivec3{0, 1, 0})
+		return m_reservations[location.server][location.dimension];
+	}
+
+	// turtles that aren't following a cooperative path still take up space,
+	// park them where they stand so cooperative paths go around them
+	void update_reservation(Turtle &turtle)
+	{
+		auto &reservations = reservations_for(turtle.position);
+		if (!turtle.current_pathing || turtle.current_pathing->finished)
 		{
-			turtle.current_pathing->pending_movement = turtle.move_up_future();
+			reservations.park(turtle.name, turtle.position.position);
 		}
-		else if (move_diff == glm::ivec3{0, -1, 0})
+		else if (turtle.current_pathing->kind != PlannerKind::cooperative)
 		{
-			turtle.current_pathing->pending_movement = turtle.move_down_future();
+			reservations.release(turtle.name);
 		}
 		else
 		{
-			turtle.current_pathing->pending_movement
-			    = turtle.move_future(orientation_to_direction(move_diff));
+			catch_up_reservation(turtle, reservations);
 		}
-		mi++;
 	}
 
-	bool turtle_requires_repath(Turtle &turtle)
+	// reservations go by the clock and turtles by the network. a turtle that
+	// is behind the steps it reserved has the rest of its path reserved again
+	// from now, before they run out from under it. if someone else took those
+	// steps it keeps the old ones, and its route aborts on the first move into
+	// another turtle and repaths
+	void catch_up_reservation(Turtle &turtle, ReservationTable &reservations)
 	{
-		return turtle.current_pathing->pather->obstacle(
-		           turtle.current_pathing->latest_results
-		               [turtle.current_pathing->movement_index + 1])
-		       || turtle.position.position
-		              != turtle.current_pathing->latest_results
-		                     [turtle.current_pathing->movement_index];
+		auto &pathing = *turtle.current_pathing;
+		auto &path = pathing.latest_results;
+		if (static_cast<size_t>(pathing.movement_index) >= path.size())
+		{
+			return;
+		}
+		// where on its path the turtle is, the last step of a wait there
+		auto at = std::find(
+		    path.begin() + pathing.movement_index,
+		    path.end(),
+		    turtle.position.position);
+		if (at == path.end())
+		{
+			return;
+		}
+		while (at + 1 != path.end() && *(at + 1) == *at)
+		{
+			at++;
+		}
+		int index = static_cast<int>(at - path.begin());
+		int now = reservations.now();
+		if (pathing.reserved_from + index >= now)
+		{
+			return;
+		}
+		if (reservations.try_reserve(
+		        turtle.name,
+		        std::vector<glm::ivec3>(at, path.end()),
+		        now))
+		{
+			pathing.reserved_from = now - index;
+		}
 	}
 
 	std::optional<std::reference_wrapper<Block>> block_at(
@@ -1310,13 +1980,16 @@ class World
 		return std::nullopt;
 	}
 
-	std::function<bool(glm::ivec3)> make_turtle_obstacle_function(Turtle &turtle)
+	// check_turtles = false leaves other turtles out, for planners that get
+	// them from the reservation table instead
+	std::function<bool(glm::ivec3)>
+	make_turtle_obstacle_function(Turtle &turtle, bool check_turtles = true)
 	{
 		return [this,
 		        name = turtle.name,
 		        server_name = turtle.position.server,
-		        dimension_name
-		        = turtle.position.dimension](glm::ivec3 location) -> bool {
+		        dimension_name = turtle.position.dimension,
+		        check_turtles](glm::ivec3 location) -> bool {
 			auto block = block_at(server_name, dimension_name, location);
 			if (block)
 			{
@@ -1328,14 +2001,19 @@ class World
 			    location + glm::ivec3{0, -1, 0});
 			if (block_below)
 			{
-				if (server_settings[server_name]
-				        .blocks_to_not_be_ontop_of.contains(
-				            block_below->get().name))
+				if (auto settings = server_settings.find(server_name);
+				    settings != server_settings.end()
+				    && settings->second.blocks_to_not_be_ontop_of.contains(
+				        block_below->get().name))
 				{
 					return true;
 				}
 			}
 
+			if (!check_turtles)
+			{
+				return false;
+			}
 			for (auto &turtle : m_turtles)
 			{
 				if (turtle.position.position == location && turtle.name != name)
@@ -1346,14 +2024,15 @@ class World
 			return false;
 		};
 	}
-	std::function<bool(glm::ivec3)>
-	make_turtle_allow_mining_obstacle_function(Turtle &turtle)
+	std::function<bool(glm::ivec3)> make_turtle_allow_mining_obstacle_function(
+	    Turtle &turtle,
+	    bool check_turtles = true)
 	{
 		return [this,
 		        name = turtle.name,
 		        server = turtle.position.server,
-		        dimension
-		        = turtle.position.dimension](glm::ivec3 position) -> bool {
+		        dimension = turtle.position.dimension,
+		        check_turtles](glm::ivec3 position) -> bool {
 			auto block = block_at(server, dimension, position);
 			if (block)
 			{
@@ -1365,13 +2044,19 @@ class World
 			auto block_below = block_at(server, dimension, position);
 			if (block_below)
 			{
-				if (server_settings[server].blocks_to_not_be_ontop_of.contains(
+				if (auto settings = server_settings.find(server);
+				    settings != server_settings.end()
+				    && settings->second.blocks_to_not_be_ontop_of.contains(
 				        block_below->get().name))
 				{
 					return true;
 				}
 			}
 
+			if (!check_turtles)
+			{
+				return false;
+			}
 			for (auto &turtle : m_turtles)
 			{
 				if (turtle.position.position == position && turtle.name != name)
@@ -1383,7 +2068,42 @@ class World
 		};
 	}
 
-	std::mutex render_mutex;
+	std::function<bool(glm::ivec3)> make_obstacle_function(
+	    ObstacleKind kind,
+	    Turtle &turtle,
+	    bool check_turtles = true)
+	{
+		switch (kind)
+		{
+		case ObstacleKind::allow_mining:
+			return make_turtle_allow_mining_obstacle_function(
+			    turtle,
+			    check_turtles);
+		case ObstacleKind::normal:
+		default:
+			return make_turtle_obstacle_function(turtle, check_turtles);
+		}
+	}
+
+	// planners search on their own threads while the world keeps changing,
+	// obstacle functions handed to them go through this
+	std::function<bool(glm::ivec3)>
+	shared_obstacle_function(std::function<bool(glm::ivec3)> obstacle)
+	{
+		return [this, obstacle = std::move(obstacle)](glm::ivec3 position) {
+			if (WorldLock::held_here)
+			{
+				return obstacle(position);
+			}
+			boost::shared_lock<boost::shared_mutex> a{world_mutex};
+			return obstacle(position);
+		};
+	}
+
+	// everything in here belongs to whoever holds this through a WorldLock,
+	// other threads post to the executor or only read while holding it shared
+	boost::shared_mutex world_mutex;
+	WorldExecutor executor;
 
 	CommandBuffer<
 	    std::optional<std::pair<WorldLocation, std::optional<nlohmann::json>>>>
@@ -1400,15 +2120,32 @@ class World
 
 	std::unordered_map<std::string, ServerSettings> server_settings;
 
+	// server -> dimension -> reservations of cooperatively pathing turtles
+	std::unordered_map<
+	    std::string,
+	    std::unordered_map<std::string, ReservationTable>>
+	    m_reservations;
+
+	RouteCache route_cache;
+	// server -> dimension -> chunk -> number of block changes seen there
+	std::unordered_map<
+	    std::string,
+	    std::unordered_map<std::string, std::unordered_map<glm::ivec3, uint64_t>>>
+	    m_chunk_versions;
+	std::mutex m_chunk_version_mutex;
+
+	ValueIndex value_index;
+	TurtleIndex turtle_index;
+
+	// server -> blocks waiting for their next recheck
+	std::unordered_map<std::string, BlockScheduler> m_block_schedulers;
+	std::mutex m_block_scheduler_mutex;
+
 	std::vector<Turtle> m_turtles;
-	std::vector<std::pair<
-	    std::shared_ptr<ComputerInterface>,
-	    boost::future<std::optional<
-	        std::pair<WorldLocation, std::optional<nlohmann::json>>>>>>
-	    m_turtles_in_progress;
 
-	std::function<void(void)> dirty_renderer;
-	std::function<void(void)> dirty_renderer_pathes;
+	// nothing to tell when there is no renderer, as in the headless build
+	std::function<void(void)> dirty_renderer = []() {};
+	std::function<void(void)> dirty_renderer_pathes = []() {};
 
 	private:
 	template <typename Archive>
@@ -1420,9 +2157,110 @@ class World
 		{
 			ar &server_settings;
 		}
+		if constexpr (Archive::is_loading::value)
+		{
+			reindex_turtles();
+			value_index.clear();
+			for (auto &server : m_blocks)
+			{
+				for (auto &dimension : server.second)
+				{
+					for (auto &x : dimension.second)
+					{
+						for (auto &y : x.second)
+						{
+							for (auto &z : y.second)
+							{
+								index_value(z.second);
+							}
+						}
+					}
+				}
+			}
+		}
 	}
 };
 
 BOOST_CLASS_VERSION(World, 1)
 
-void server_automation(World &world, const std::string server_name, bool &stop);
+// co_await until_ready(world, future) in a TurtleTask, gives what the future
+// resolved to, nullopt if it threw
+template <typename T>
+struct FutureAwaiter
+{
+	World &world;
+	boost::future<T> future;
+	// shared with the handler, which may run after the task is dropped
+	std::shared_ptr<std::optional<T>> result
+	    = std::make_shared<std::optional<T>>();
+
+	bool await_ready() { return false; }
+	void await_suspend(TurtleTask::handle_type handle)
+	{
+		world.when_ready(
+		    std::move(future),
+		    [result = result, resume = TurtleTask::resumer(handle)](
+		        std::optional<T> value) {
+			    *result = std::move(value);
+			    resume();
+		    });
+	}
+	std::optional<T> await_resume() { return std::move(*result); }
+};
+
+template <typename T>
+FutureAwaiter<T> until_ready(World &world, boost::future<T> future)
+{
+	return FutureAwaiter<T>{world, std::move(future)};
+}
+
+// co_await walk(world, name, pathing) in a TurtleTask, sets the turtle
+// going and gives whether it got to the target
+struct WalkAwaiter
+{
+	World &world;
+	std::string turtle_name;
+	Pathing pathing;
+	std::shared_ptr<bool> reached = std::make_shared<bool>(false);
+
+	bool await_ready() { return false; }
+	bool await_suspend(TurtleTask::handle_type handle)
+	{
+		auto turtle = world.turtle_named(turtle_name);
+		if (!turtle)
+		{
+			return false;
+		}
+		// finish is called by the pathing itself, posting keeps the task
+		// from replacing the pathing while it's still running
+		pathing.on_finished = [&executor = world.executor,
+		                       reached = reached,
+		                       resume = TurtleTask::resumer(handle)](
+		                          bool got_there) {
+			*reached = got_there;
+			executor.post(resume);
+		};
+		turtle->replace_pathing(std::move(pathing));
+		return true;
+	}
+	bool await_resume() { return *reached; }
+};
+
+inline WalkAwaiter walk(World &world, std::string name, Pathing pathing)
+{
+	return WalkAwaiter{world, std::move(name), std::move(pathing)};
+}
+
+// schedules everything with a value on a server the automation just
+// started looking after
+void start_server_automation(World &world, const std::string &server_name);
+// moves the turtles on a server along with their actions and hands out the
+// blocks that came due, called by the automation engine with the world held
+void server_automation_step(World &world, const std::string &server_name);
+// the closest idle turtle with one of jobs
+std::optional<std::reference_wrapper<Turtle>> find_closest_turtle(
+    glm::ivec3 position,
+    TurtleValue::jobs jobs,
+    World &world,
+    std::string server_name,
+    std::string dimension);